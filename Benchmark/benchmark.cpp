@@ -0,0 +1,385 @@
+/*
+* benchmark.cpp
+* This file benchmarks rendering and loading of the default scene
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* Usage       :  Benchmark [frames] [width] [height] [--instances count]
+*                Benchmark --load [iterations] [--no-mesh-cache] [--copy-vertices] [--async] [--no-optimize]
+*                          [--no-lods] [--float-vertices] [--no-compress]
+*                          [--preset fast-load|optimized-render|max-quality]
+*                Benchmark --golden [--update]
+* The first form times rendering, with --instances drawing a grid of
+* that many cups. The second times each stage of model loading. The
+* third compares fixed camera poses with the reference images and
+* timings in golden/, which must first be generated with --update on a
+* known-good build and committed. Run from the Final_Project directory
+* so the shader, texture and model paths resolve. Build with HEADLESS_EGL
+* defined (and link EGL) to run on Linux machines without a display, e.g.
+* under Mesa llvmpipe.
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "headless.h"
+#include "scene.h"
+#include "glstate.h"
+#include "glstats.h"
+#include "bufferheap.h"
+#include "gpumem.h"
+#include "texturearrays.h"
+#include "golden.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Returns the value at the given percentile of sorted samples
+double percentile(const std::vector<double>& sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0.0;
+	}
+	size_t index = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+	return sorted.at(index);
+}
+
+// Asks the OS to drop cached pages for every file in a directory so the
+// next load reads from disk. Only supported on Linux, elsewhere the first
+// load in the process is the closest thing to a cold load.
+void evictFileCache(const std::string& directory)
+{
+#ifdef __linux__
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		int fd = open(entry.path().c_str(), O_RDONLY);
+		if (fd >= 0)
+		{
+			fdatasync(fd);
+			posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+			close(fd);
+		}
+	}
+#endif
+}
+
+void printLoadHeader()
+{
+	const char* columns[] = { "readFile", "postProc", "optimize", "lods", "process", "materials", "decode", "decWait",
+		"texUpload", "meshUpload", "total" };
+	std::cout << std::left << std::setw(24) << "model" << std::right;
+	for (size_t i = 0; i < 11; i++)
+	{
+		std::cout << std::setw(11) << columns[i];
+	}
+	std::cout << std::setw(8) << "meshes" << std::setw(8) << "mapped" << std::setw(9) << "textures" << std::setw(8) << "source" << std::endl;
+}
+
+void printLoadStats(const std::string& name, const model::LoadStats& stats)
+{
+	std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(11) << stats.readFileMs
+		<< std::setw(11) << stats.postProcessMs
+		<< std::setw(11) << stats.optimizeMs
+		<< std::setw(11) << stats.lodMs
+		<< std::setw(11) << stats.processMs
+		<< std::setw(11) << stats.materialsMs
+		<< std::setw(11) << stats.decodeMs
+		<< std::setw(11) << stats.decodeWaitMs
+		<< std::setw(11) << stats.textureUploadMs
+		<< std::setw(11) << stats.meshUploadMs
+		<< std::setw(11) << stats.totalMs
+		<< std::setw(8) << stats.meshes
+		<< std::setw(8) << stats.mappedMeshes
+		<< std::setw(9) << stats.textures
+		<< std::setw(8) << (stats.fromCache ? "cache" : "assimp") << std::endl;
+}
+
+void addLoadStats(model::LoadStats& total, const model::LoadStats& stats, double weight)
+{
+	total.readFileMs += stats.readFileMs * weight;
+	total.postProcessMs += stats.postProcessMs * weight;
+	total.optimizeMs += stats.optimizeMs * weight;
+	total.lodMs += stats.lodMs * weight;
+	total.processMs += stats.processMs * weight;
+	total.materialsMs += stats.materialsMs * weight;
+	total.decodeMs += stats.decodeMs * weight;
+	total.decodeWaitMs += stats.decodeWaitMs * weight;
+	total.textureUploadMs += stats.textureUploadMs * weight;
+	total.meshUploadMs += stats.meshUploadMs * weight;
+	total.totalMs += stats.totalMs * weight;
+}
+
+// Loads every scene model and reports the time spent in each loading stage,
+// once with the file cache dropped and averaged over warm reloads. The first
+// load writes any missing mesh cache, so later iterations read from it.
+int runLoadBenchmark(unsigned int iterations, model::LoadOptions options)
+{
+	// Texture and buffer uploads need a context
+	if (!headless::initialize(64, 64))
+	{
+		return EXIT_FAILURE;
+	}
+
+	const std::vector<std::string> paths{
+		"models/book/book.obj",
+		"models/headphones/headphones.obj",
+		"models/pen/pen.obj",
+		"models/cup/cup.obj"
+	};
+
+	std::vector<model::LoadStats> cold(paths.size());
+	std::vector<model::LoadStats> warm(paths.size());
+	double warmWeight = (iterations > 1) ? 1.0 / (iterations - 1) : 0.0;
+
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		for (size_t j = 0; j < paths.size(); j++)
+		{
+			if (i == 0)
+			{
+				evictFileCache(paths.at(j).substr(0, paths.at(j).find_last_of('/')));
+			}
+
+			// Empties the texture cache so every load decodes and uploads its images
+			textures::cache().clear();
+			model::Model loaded{ paths.at(j).c_str(), options };
+			loaded.wait();
+			if (i == 0)
+			{
+				cold.at(j) = loaded.loadStats;
+			}
+			else
+			{
+				addLoadStats(warm.at(j), loaded.loadStats, warmWeight);
+				warm.at(j).meshes = loaded.loadStats.meshes;
+				warm.at(j).textures = loaded.loadStats.textures;
+				warm.at(j).mappedMeshes = loaded.loadStats.mappedMeshes;
+				warm.at(j).fromCache = loaded.loadStats.fromCache;
+			}
+		}
+	}
+
+	// -------------------- REPORT --------------------
+	const char* cacheNames[] = { "cold", "warm" };
+	std::vector<model::LoadStats>* results[] = { &cold, &warm };
+	for (size_t c = 0; c < 2; c++)
+	{
+		if (c == 1 && iterations < 2)
+		{
+			break;
+		}
+		std::cout << std::endl << "---- " << cacheNames[c] << " file cache (ms) ----" << std::endl;
+		printLoadHeader();
+		model::LoadStats total;
+		total.fromCache = true;
+		for (size_t j = 0; j < paths.size(); j++)
+		{
+			printLoadStats(paths.at(j), results[c]->at(j));
+			addLoadStats(total, results[c]->at(j), 1.0);
+			total.meshes += results[c]->at(j).meshes;
+			total.textures += results[c]->at(j).textures;
+			total.mappedMeshes += results[c]->at(j).mappedMeshes;
+			total.fromCache = total.fromCache && results[c]->at(j).fromCache;
+		}
+		printLoadStats("total", total);
+	}
+
+	// Every load released its meshes, so the blocks should hold only free space
+	std::cout << std::endl;
+	bufferheap::report(std::cout);
+
+	headless::terminate();
+	return 0;
+}
+
+// Renders the scene offscreen and reports frame time percentiles
+int runFrameBenchmark(unsigned int frames, unsigned int width, unsigned int height, unsigned int instances)
+{
+	const unsigned int WARMUP_FRAMES = 10;
+
+	// -------------------- INITIALIZATION --------------------
+	if (!headless::initialize(width, height))
+	{
+		return EXIT_FAILURE;
+	}
+	std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+	headless::Framebuffer framebuffer{ width, height };
+	framebuffer.bind();
+
+	GLfloat aspect = (float)width / (float)height;
+	// Destroyed before the context, its destructors delete GL objects
+	std::unique_ptr<scene::Scene> deskScene = std::make_unique<scene::Scene>(aspect);
+
+	// Copies of the cup on a square grid behind the desk, all drawn by the
+	// cup's instanced draws
+	const float SPACING = 4.0f;
+	unsigned int side = (unsigned int)std::ceil(std::sqrt((double)instances));
+	if (instances > 1)
+	{
+		deskScene->cup.clearInstances();
+		for (unsigned int i = 0; i < instances; i++)
+		{
+			glm::vec3 offset{ ((float)(i % side) - side * 0.5f) * SPACING, 0.0f, -(float)(i / side) * SPACING };
+			deskScene->cup.addInstance(glm::translate(glm::mat4(1.0f), offset));
+		}
+	}
+
+	// Same starting camera as the interactive application
+	glm::vec3 cameraPos{ 0.0f, 3.0f, 20.0f };
+	glm::mat4 view = glm::lookAt(cameraPos,
+		cameraPos + glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// ~~~~~~~~~~~~~~~~~~~~ RENDER LOOP ~~~~~~~~~~~~~~~~~~~~~~~
+	// glFinish makes each sample cover CPU submission and GPU execution
+	std::vector<double> frameTimes;
+	frameTimes.reserve(frames);
+	size_t drawCalls = 0;
+
+	for (unsigned int i = 0; i < WARMUP_FRAMES + frames; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		drawCalls = deskScene->draw(view, cameraPos);
+		glFinish();
+		auto end = std::chrono::steady_clock::now();
+
+		if (i >= WARMUP_FRAMES)
+		{
+			frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+	}
+
+	// One more frame with the call counters installed, kept
+	// out of the timed frames so counting does not skew them
+	glstats::install();
+	glstats::beginFrame();
+	glstate::resetCounters();
+	deskScene->draw(view, cameraPos);
+	glstats::endFrame();
+	glstats::uninstall();
+
+	// -------------------- REPORT --------------------
+	std::sort(frameTimes.begin(), frameTimes.end());
+	std::cout << "Frames     : " << frames << " (" << width << "x" << height << ")" << std::endl;
+	std::cout << "Cups       : " << deskScene->cup.instanceCount() << std::endl;
+	std::cout << "Draw calls : " << drawCalls << " per frame" << std::endl;
+	std::cout << "p50        : " << percentile(frameTimes, 50.0) << " ms" << std::endl;
+	std::cout << "p95        : " << percentile(frameTimes, 95.0) << " ms" << std::endl;
+	std::cout << "p99        : " << percentile(frameTimes, 99.0) << " ms" << std::endl;
+	std::cout << "max        : " << (frameTimes.empty() ? 0.0 : frameTimes.back()) << " ms" << std::endl;
+	std::cout << std::endl << "GL calls per frame" << std::endl;
+	glstats::report(std::cout, glstats::lastFrame());
+	std::cout << std::endl << "State changes per frame" << std::endl;
+	glstate::report(std::cout);
+	std::cout << std::endl;
+	gpumem::report(std::cout);
+	std::cout << std::endl;
+	bufferheap::report(std::cout);
+	std::cout << std::endl;
+	texturearrays::report(std::cout);
+
+	deskScene.reset();
+	framebuffer.destroy();
+	headless::terminate();
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	// -------------------- ARGUMENTS --------------------
+	if (argc > 1 && std::string(argv[1]) == "--load")
+	{
+		unsigned int iterations = 5;
+		model::LoadOptions options;
+		for (int i = 2; i < argc; i++)
+		{
+			if (std::string(argv[i]) == "--no-mesh-cache")
+			{
+				options.useMeshCache = false;
+			}
+			else if (std::string(argv[i]) == "--copy-vertices")
+			{
+				options.zeroCopy = false;
+			}
+			else if (std::string(argv[i]) == "--no-optimize")
+			{
+				options.optimize = false;
+			}
+			else if (std::string(argv[i]) == "--no-lods")
+			{
+				options.lods = false;
+			}
+			else if (std::string(argv[i]) == "--float-vertices")
+			{
+				options.vertexFormat = mesh::VertexFormat::Float;
+			}
+			else if (std::string(argv[i]) == "--no-compress")
+			{
+				options.compressTextures = false;
+				textures::cache().compress = false;
+			}
+			else if (std::string(argv[i]) == "--async")
+			{
+				options.async = true;
+			}
+			else if (std::string(argv[i]) == "--preset" && i + 1 < argc)
+			{
+				if (!model::parsePreset(argv[++i], options.preset))
+				{
+					return EXIT_FAILURE;
+				}
+			}
+			else
+			{
+				iterations = std::stoi(argv[i]);
+			}
+		}
+		return runLoadBenchmark(iterations, options);
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--golden")
+	{
+		golden::Settings settings;
+		settings.update = (argc > 2 && std::string(argv[2]) == "--update");
+		return golden::run(settings) == 0 ? 0 : EXIT_FAILURE;
+	}
+
+	unsigned int instances = 1;
+	std::vector<std::string> sizes;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--instances" && i + 1 < argc)
+		{
+			instances = std::stoi(argv[++i]);
+		}
+		else
+		{
+			sizes.push_back(argv[i]);
+		}
+	}
+	unsigned int frames = (sizes.size() > 0) ? std::stoi(sizes.at(0)) : 500;
+	unsigned int width = (sizes.size() > 1) ? std::stoi(sizes.at(1)) : 960;
+	unsigned int height = (sizes.size() > 2) ? std::stoi(sizes.at(2)) : 540;
+	return runFrameBenchmark(frames, width, height, instances);
+}
@@ -0,0 +1,282 @@
+/*
+* golden.cpp
+* This file contains implementations for the golden-image regression tests
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "golden.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "headless.h"
+#include "scene.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+
+namespace golden
+{
+	// Helper functions
+
+	// Writes RGB pixels read from OpenGL (bottom row first) as a binary PPM
+	bool writePPM(const std::string& path, const std::vector<unsigned char>& pixels,
+		unsigned int width, unsigned int height)
+	{
+		std::ofstream file{ path, std::ios::binary };
+		if (!file)
+		{
+			return false;
+		}
+		file << "P6\n" << width << " " << height << "\n255\n";
+		for (unsigned int row = 0; row < height; row++)
+		{
+			const unsigned char* line = &pixels[(height - 1 - row) * width * 3];
+			file.write((const char*)line, width * 3);
+		}
+		return true;
+	}
+
+	// Reads a binary PPM back into OpenGL row order
+	bool readPPM(const std::string& path, std::vector<unsigned char>& pixels,
+		unsigned int& width, unsigned int& height)
+	{
+		std::ifstream file{ path, std::ios::binary };
+		std::string magic;
+		unsigned int maxValue = 0;
+		if (!(file >> magic >> width >> height >> maxValue) || magic != "P6" || maxValue != 255)
+		{
+			return false;
+		}
+		file.get(); // single whitespace before the pixel data
+
+		pixels.resize(width * height * 3);
+		for (unsigned int row = 0; row < height; row++)
+		{
+			file.read((char*)&pixels[(height - 1 - row) * width * 3], width * 3);
+		}
+		return (bool)file;
+	}
+
+	// Baseline file holds one "pose milliseconds" pair per line
+	std::map<std::string, double> readBaseline(const std::string& path)
+	{
+		std::map<std::string, double> baseline;
+		std::ifstream file{ path };
+		std::string name;
+		double ms;
+		while (file >> name >> ms)
+		{
+			baseline[name] = ms;
+		}
+		return baseline;
+	}
+
+	std::vector<Pose> defaultPoses()
+	{
+		return std::vector<Pose>{
+			// name        camera position                   looks at
+			{ "start",     glm::vec3(0.0f, 3.0f, 20.0f),     glm::vec3(0.0f, 3.0f, 19.0f) },
+			{ "overhead",  glm::vec3(0.0f, 25.0f, 8.0f),     glm::vec3(0.0f, 0.0f, 7.0f) },
+			{ "desk_left", glm::vec3(-14.0f, 6.0f, 14.0f),   glm::vec3(0.0f, 0.0f, 7.0f) },
+			{ "desk_right",glm::vec3(14.0f, 6.0f, 14.0f),    glm::vec3(0.0f, 0.0f, 7.0f) },
+			{ "cup_close", glm::vec3(-5.0f, 3.0f, 10.0f),    glm::vec3(-5.0f, 0.5f, 5.0f) },
+			{ "light",     glm::vec3(10.0f, 10.0f, 10.0f),   glm::vec3(20.0f, 20.0f, 20.0f) }
+		};
+	}
+
+	// Lists the reference images and baseline a comparison needs but doesn't
+	// have. None ship with the repository, they have to be generated with
+	// --update on a build known to be good and committed.
+	std::vector<std::string> missingFiles(const Settings& settings)
+	{
+		std::vector<std::string> missing;
+		std::vector<Pose> poses = defaultPoses();
+		for (size_t i = 0; i < poses.size(); i++)
+		{
+			std::string referencePath = settings.directory + "/" + poses.at(i).name + ".ppm";
+			if (!std::filesystem::exists(referencePath))
+			{
+				missing.push_back(referencePath);
+			}
+		}
+		if (!std::filesystem::exists(settings.directory + "/baseline.txt"))
+		{
+			missing.push_back(settings.directory + "/baseline.txt");
+		}
+		return missing;
+	}
+
+	int run(const Settings& settings)
+	{
+		// A comparison without references would pass by default, so it fails before rendering
+		if (!settings.update)
+		{
+			std::vector<std::string> missing = missingFiles(settings);
+			if (!missing.empty())
+			{
+				for (size_t i = 0; i < missing.size(); i++)
+				{
+					std::cout << "ERROR: missing " << missing.at(i) << std::endl;
+				}
+				std::cout << "ERROR: no golden references to compare against, run --golden --update"
+					<< " on a known-good build and commit " << settings.directory << "/" << std::endl;
+				return (int)missing.size();
+			}
+		}
+
+		// -------------------- INITIALIZATION --------------------
+		if (!headless::initialize(settings.width, settings.height))
+		{
+			return 1;
+		}
+		std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+		headless::Framebuffer framebuffer{ settings.width, settings.height };
+		framebuffer.bind();
+		// Owned by pointer so it is freed before headless::terminate below
+		std::unique_ptr<scene::Scene> deskScene =
+			std::make_unique<scene::Scene>((float)settings.width / (float)settings.height);
+
+		std::string baselinePath = settings.directory + "/baseline.txt";
+		std::map<std::string, double> baseline = readBaseline(baselinePath);
+		std::map<std::string, double> measured;
+		if (settings.update)
+		{
+			std::filesystem::create_directories(settings.directory);
+		}
+
+		// -------------------- POSES --------------------
+		int failures = 0;
+		std::vector<Pose> poses = defaultPoses();
+		for (size_t i = 0; i < poses.size(); i++)
+		{
+			const Pose& pose = poses.at(i);
+			glm::mat4 view = glm::lookAt(pose.position, pose.target, glm::vec3(0.0f, 1.0f, 0.0f));
+
+			// Renders once untimed, then keeps the median of the timed frames
+			deskScene->draw(view, pose.position);
+			glFinish();
+			std::vector<double> times;
+			for (unsigned int f = 0; f < settings.timedFrames; f++)
+			{
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				deskScene->draw(view, pose.position);
+				glFinish();
+				times.push_back(profiler::elapsedMs(start));
+			}
+			std::sort(times.begin(), times.end());
+			double ms = times.empty() ? 0.0 : times.at(times.size() / 2);
+			measured[pose.name] = ms;
+
+			std::vector<unsigned char> pixels = framebuffer.readPixels();
+			std::string referencePath = settings.directory + "/" + pose.name + ".ppm";
+
+			if (settings.update)
+			{
+				writePPM(referencePath, pixels, settings.width, settings.height);
+				std::cout << "UPDATED " << pose.name << "  " << ms << " ms" << std::endl;
+				continue;
+			}
+
+			// --------------- IMAGE ---------------
+			std::vector<unsigned char> reference;
+			unsigned int refWidth = 0, refHeight = 0;
+			bool imagePassed = false;
+			double badFraction = 1.0;
+			if (!readPPM(referencePath, reference, refWidth, refHeight))
+			{
+				std::cout << "MISSING " << referencePath << " (run with --update)" << std::endl;
+			}
+			else if (refWidth != settings.width || refHeight != settings.height)
+			{
+				std::cout << "SIZE    " << pose.name << " reference is " << refWidth << "x" << refHeight << std::endl;
+			}
+			else
+			{
+				// Counts pixels with any channel outside the tolerance and marks them in a diff image
+				std::vector<unsigned char> diff(pixels.size(), 0);
+				size_t badPixels = 0;
+				for (size_t p = 0; p < pixels.size(); p += 3)
+				{
+					bool bad = false;
+					for (size_t c = 0; c < 3; c++)
+					{
+						if (std::abs((int)pixels.at(p + c) - (int)reference.at(p + c)) > settings.channelTolerance)
+						{
+							bad = true;
+						}
+					}
+					if (bad)
+					{
+						badPixels++;
+						diff.at(p) = 255;
+					}
+				}
+				badFraction = (double)badPixels / (settings.width * settings.height);
+				imagePassed = badFraction <= settings.maxBadPixels;
+
+				if (!imagePassed)
+				{
+					writePPM(settings.directory + "/" + pose.name + ".actual.ppm", pixels, settings.width, settings.height);
+					writePPM(settings.directory + "/" + pose.name + ".diff.ppm", diff, settings.width, settings.height);
+				}
+			}
+
+			// --------------- TIMING ---------------
+			// Poses added since the baseline was written have nothing to compare with
+			bool timePassed = false;
+			double baselineMs = 0.0;
+			if (baseline.count(pose.name))
+			{
+				baselineMs = baseline[pose.name];
+				timePassed = ms <= baselineMs * settings.maxSlowdown;
+			}
+
+			std::cout << (imagePassed && timePassed ? "PASS    " : "FAIL    ") << pose.name
+				<< "  bad pixels " << badFraction * 100.0 << "%"
+				<< "  time " << ms << " ms";
+			if (baselineMs > 0.0)
+			{
+				std::cout << " (baseline " << baselineMs << " ms" << (timePassed ? ")" : ", SLOWER)");
+			}
+			else
+			{
+				std::cout << " (not in baseline, run with --update)";
+			}
+			std::cout << std::endl;
+
+			if (!imagePassed || !timePassed)
+			{
+				failures++;
+			}
+		}
+
+		if (settings.update)
+		{
+			std::ofstream file{ baselinePath };
+			std::map<std::string, double>::iterator it;
+			for (it = measured.begin(); it != measured.end(); it++)
+			{
+				file << it->first << " " << it->second << "\n";
+			}
+		}
+
+		std::cout << failures << " of " << poses.size() << " poses failed" << std::endl;
+		deskScene.reset();
+		framebuffer.destroy();
+		headless::terminate();
+		return failures;
+	}
+}
@@ -0,0 +1,46 @@
+/*
+* golden.h
+* This file contains declarations for the golden-image regression tests
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+namespace golden
+{
+	// Fixed camera used for one reference image
+	struct Pose
+	{
+		std::string name;
+		glm::vec3 position;
+		glm::vec3 target;
+	};
+
+	struct Settings
+	{
+		std::string directory;     // where references and the timing baseline live
+		unsigned int width, height;
+		unsigned int timedFrames;  // frames rendered per pose to measure time
+		int channelTolerance;      // largest per-channel difference that still matches
+		double maxBadPixels;       // fraction of pixels allowed outside the tolerance
+		double maxSlowdown;        // allowed ratio of measured to baseline time
+		bool update;               // rewrite references and baseline instead of comparing
+		Settings() : directory{ "golden" }, width{ 480 }, height{ 270 }, timedFrames{ 20 },
+			channelTolerance{ 8 }, maxBadPixels{ 0.005 }, maxSlowdown{ 1.25 }, update{ false } {}
+	};
+
+	std::vector<Pose> defaultPoses();
+	// Renders every pose, compares images and timings, returns the number of failures
+	int run(const Settings& settings);
+}
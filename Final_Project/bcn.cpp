@@ -0,0 +1,431 @@
+/*
+* bcn.cpp
+* This file contains implementations for the BC1, BC3, BC4 and BC5 texture encoder
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+* Block layouts from the EXT_texture_compression_s3tc and
+* ARB_texture_compression_rgtc specifications.
+*/
+
+#include "bcn.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include "workers.h"
+
+// Every x64 compiler has SSE2
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BCN_SSE2
+#endif
+
+namespace bcn
+{
+	// Helper functions
+
+	// Copies a 4x4 block into RGBA, repeating the last row and column past the image edges
+	void fetchBlock(const unsigned char* pixels, int width, int height, int components,
+		int blockX, int blockY, unsigned char* rgba)
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			int sourceY = std::min(blockY * 4 + y, height - 1);
+			for (int x = 0; x < 4; x++)
+			{
+				int sourceX = std::min(blockX * 4 + x, width - 1);
+				const unsigned char* source = pixels + ((size_t)sourceY * width + sourceX) * components;
+				unsigned char* target = rgba + (y * 4 + x) * 4;
+				target[0] = source[0];
+				target[1] = components > 1 ? source[1] : 0;
+				target[2] = components > 2 ? source[2] : 0;
+				target[3] = components > 3 ? source[3] : 255;
+			}
+		}
+	}
+
+	unsigned short pack565(const float* color)
+	{
+		int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+		int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+		int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+		return (unsigned short)((r << 11) | (g << 5) | b);
+	}
+
+	// Expands to 8 bits per channel the way the hardware does
+	void unpack565(unsigned short packed, float* color)
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (float)((r << 3) | (r >> 2));
+		color[1] = (float)((g << 2) | (g >> 4));
+		color[2] = (float)((b << 3) | (b >> 2));
+	}
+
+	// Picks the closest of the four palette colors for every pixel, returns the squared error
+	float selectIndices(const float* r, const float* g, const float* b, const float palette[4][3],
+		unsigned char* indices)
+	{
+		float error = 0.0f;
+#ifdef BCN_SSE2
+		// Four pixels at a time
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128 red = _mm_loadu_ps(r + i);
+			__m128 green = _mm_loadu_ps(g + i);
+			__m128 blue = _mm_loadu_ps(b + i);
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int k = 0; k < 4; k++)
+			{
+				__m128 dr = _mm_sub_ps(red, _mm_set1_ps(palette[k][0]));
+				__m128 dg = _mm_sub_ps(green, _mm_set1_ps(palette[k][1]));
+				__m128 db = _mm_sub_ps(blue, _mm_set1_ps(palette[k][2]));
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex), _mm_and_si128(closer, _mm_set1_epi32(k)));
+			}
+			float distances[4];
+			int32_t chosen[4];
+			_mm_storeu_ps(distances, best);
+			_mm_storeu_si128((__m128i*)chosen, bestIndex);
+			for (int j = 0; j < 4; j++)
+			{
+				indices[i + j] = (unsigned char)chosen[j];
+				error += distances[j];
+			}
+		}
+#else
+		for (int i = 0; i < 16; i++)
+		{
+			float best = FLT_MAX;
+			for (int k = 0; k < 4; k++)
+			{
+				float dr = r[i] - palette[k][0];
+				float dg = g[i] - palette[k][1];
+				float db = b[i] - palette[k][2];
+				float distance = dr * dr + dg * dg + db * db;
+				if (distance < best)
+				{
+					best = distance;
+					indices[i] = (unsigned char)k;
+				}
+			}
+			error += best;
+		}
+#endif
+		return error;
+	}
+
+	float fitIndices(unsigned short c0, unsigned short c1, const float* r, const float* g, const float* b,
+		unsigned char* indices)
+	{
+		// Four color mode: the endpoints and two colors a third of the way between them
+		float palette[4][3];
+		unpack565(c0, palette[0]);
+		unpack565(c1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+		return selectIndices(r, g, b, palette, indices);
+	}
+
+	// Solves for the endpoints that best reproduce the pixels with the chosen indices
+	bool refineEndpoints(const float* r, const float* g, const float* b, const unsigned char* indices,
+		float* e0, float* e1)
+	{
+		const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[3] = { 0.0f, 0.0f, 0.0f };
+		float bx[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float a = weights[indices[i]];
+			float rest = 1.0f - a;
+			const float pixel[3] = { r[i], g[i], b[i] };
+			aa += a * a;
+			ab += a * rest;
+			bb += rest * rest;
+			for (int c = 0; c < 3; c++)
+			{
+				ax[c] += a * pixel[c];
+				bx[c] += rest * pixel[c];
+			}
+		}
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			e0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+			e1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+		}
+		return true;
+	}
+
+	void writeColorBlock(unsigned short c0, unsigned short c1, unsigned char* indices, unsigned char* out)
+	{
+		// c0 > c1 selects four color mode, swapping the endpoints swaps indices 0/1 and 2/3
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			for (int i = 0; i < 16; i++)
+			{
+				indices[i] ^= 1;
+			}
+		}
+		else if (c0 == c1)
+		{
+			std::fill(indices, indices + 16, 0);
+		}
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			bits |= (uint32_t)indices[i] << (i * 2);
+		}
+		out[0] = (unsigned char)(c0 & 0xff);
+		out[1] = (unsigned char)(c0 >> 8);
+		out[2] = (unsigned char)(c1 & 0xff);
+		out[3] = (unsigned char)(c1 >> 8);
+		for (int i = 0; i < 4; i++)
+		{
+			out[4 + i] = (unsigned char)(bits >> (i * 8));
+		}
+	}
+
+	// BC1 block, also the color half of BC3
+	void encodeColorBlock(const unsigned char* rgba, unsigned char* out)
+	{
+		float r[16], g[16], b[16];
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			r[i] = rgba[i * 4];
+			g[i] = rgba[i * 4 + 1];
+			b[i] = rgba[i * 4 + 2];
+			mean[0] += r[i];
+			mean[1] += g[i];
+			mean[2] += b[i];
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			mean[c] /= 16.0f;
+		}
+
+		// Principal axis of the colors by power iteration on their covariance
+		float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float dr = r[i] - mean[0];
+			float dg = g[i] - mean[1];
+			float db = b[i] - mean[2];
+			covariance[0] += dr * dr;
+			covariance[1] += dr * dg;
+			covariance[2] += dr * db;
+			covariance[3] += dg * dg;
+			covariance[4] += dg * db;
+			covariance[5] += db * db;
+		}
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+			float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+			float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+			float largest = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+			if (largest < 1e-6f)
+			{
+				break;
+			}
+			axis[0] = x / largest;
+			axis[1] = y / largest;
+			axis[2] = z / largest;
+		}
+		float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		for (int c = 0; c < 3; c++)
+		{
+			axis[c] /= length;
+		}
+
+		// Endpoints at the colors furthest along the axis
+		float minT = FLT_MAX, maxT = -FLT_MAX;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = (r[i] - mean[0]) * axis[0] + (g[i] - mean[1]) * axis[1] + (b[i] - mean[2]) * axis[2];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+		float e0[3], e1[3];
+		for (int c = 0; c < 3; c++)
+		{
+			e0[c] = mean[c] + axis[c] * maxT;
+			e1[c] = mean[c] + axis[c] * minT;
+		}
+
+		unsigned short c0 = pack565(e0);
+		unsigned short c1 = pack565(e1);
+		unsigned char indices[16];
+		float error = fitIndices(c0, c1, r, g, b, indices);
+
+		if (error > 0.0f && refineEndpoints(r, g, b, indices, e0, e1))
+		{
+			unsigned short refined0 = pack565(e0);
+			unsigned short refined1 = pack565(e1);
+			unsigned char refinedIndices[16];
+			if (fitIndices(refined0, refined1, r, g, b, refinedIndices) < error)
+			{
+				c0 = refined0;
+				c1 = refined1;
+				std::copy(refinedIndices, refinedIndices + 16, indices);
+			}
+		}
+		writeColorBlock(c0, c1, indices, out);
+	}
+
+	// BC4 block, also the alpha half of BC3 and each half of BC5
+	void encodeChannelBlock(const unsigned char* rgba, int channel, unsigned char* out)
+	{
+		unsigned char lowest = 255, highest = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			lowest = std::min(lowest, rgba[i * 4 + channel]);
+			highest = std::max(highest, rgba[i * 4 + channel]);
+		}
+		out[0] = highest;
+		out[1] = lowest;
+
+		// Eight value mode: the endpoints and six values evenly between them
+		float palette[8];
+		palette[0] = highest;
+		palette[1] = lowest;
+		for (int k = 1; k < 7; k++)
+		{
+			palette[k + 1] = ((7 - k) * highest + k * lowest) / 7.0f;
+		}
+
+		uint64_t bits = 0;
+		if (highest != lowest)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				float value = rgba[i * 4 + channel];
+				uint64_t best = 0;
+				for (int k = 1; k < 8; k++)
+				{
+					if (std::fabs(value - palette[k]) < std::fabs(value - palette[best]))
+					{
+						best = k;
+					}
+				}
+				bits |= best << (i * 3);
+			}
+		}
+		for (int i = 0; i < 6; i++)
+		{
+			out[2 + i] = (unsigned char)(bits >> (i * 8));
+		}
+	}
+
+	void compressRows(const unsigned char* pixels, int width, int height, int components,
+		Format format, unsigned char* output, int firstRow, int endRow)
+	{
+		int blocksWide = (width + 3) / 4;
+		size_t bytes = blockBytes(format);
+		unsigned char rgba[64];
+		for (int blockY = firstRow; blockY < endRow; blockY++)
+		{
+			for (int blockX = 0; blockX < blocksWide; blockX++)
+			{
+				fetchBlock(pixels, width, height, components, blockX, blockY, rgba);
+				unsigned char* block = output + ((size_t)blockY * blocksWide + blockX) * bytes;
+				switch (format)
+				{
+				case Format::BC1:
+					encodeColorBlock(rgba, block);
+					break;
+				case Format::BC3:
+					encodeChannelBlock(rgba, 3, block);
+					encodeColorBlock(rgba, block + 8);
+					break;
+				case Format::BC4:
+					encodeChannelBlock(rgba, 0, block);
+					break;
+				case Format::BC5:
+					encodeChannelBlock(rgba, 0, block);
+					encodeChannelBlock(rgba, 1, block + 8);
+					break;
+				}
+			}
+		}
+	}
+
+	Format formatFor(int components)
+	{
+		switch (components)
+		{
+		case 1: return Format::BC4;
+		case 2: return Format::BC5;
+		case 3: return Format::BC1;
+		default: return Format::BC3;
+		}
+	}
+
+	GLenum internalFormat(Format format)
+	{
+		switch (format)
+		{
+		case Format::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case Format::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case Format::BC4: return GL_COMPRESSED_RED_RGTC1;
+		default: return GL_COMPRESSED_RG_RGTC2;
+		}
+	}
+
+	GLenum baseFormat(Format format)
+	{
+		switch (format)
+		{
+		case Format::BC1: return GL_RGB;
+		case Format::BC3: return GL_RGBA;
+		case Format::BC4: return GL_RED;
+		default: return GL_RG;
+		}
+	}
+
+	size_t blockBytes(Format format)
+	{
+		return (format == Format::BC1 || format == Format::BC4) ? 8 : 16;
+	}
+
+	size_t compressedSize(Format format, int width, int height)
+	{
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+	}
+
+	void compress(const unsigned char* pixels, int width, int height, int components,
+		Format format, unsigned char* output, bool parallel)
+	{
+		int blocksHigh = (height + 3) / 4;
+		if (!parallel)
+		{
+			compressRows(pixels, width, height, components, format, output, 0, blocksHigh);
+			return;
+		}
+		workers::parallelFor(blocksHigh, [=](size_t firstRow, size_t endRow) {
+			compressRows(pixels, width, height, components, format, output, (int)firstRow, (int)endRow);
+		});
+	}
+}
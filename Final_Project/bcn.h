@@ -0,0 +1,59 @@
+/*
+* bcn.h
+* This file contains declarations for the BC1, BC3, BC4 and BC5 texture encoder
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+* Block layouts from the EXT_texture_compression_s3tc and
+* ARB_texture_compression_rgtc specifications.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <string>
+
+// glad was generated without extensions, S3TC is an extension every
+// desktop driver has but it is not core
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Compresses 4x4 pixel blocks to a fixed number of bytes: BC1 stores RGB
+// in 8 bytes, BC3 adds an 8 byte alpha block, BC4 stores one channel in
+// 8 bytes and BC5 two. Colors are fit along their principal axis and
+// refined with one least squares pass.
+
+namespace bcn
+{
+	// Stored in the KTX files, changing the encoder's output must change it
+	const std::string ENCODER = "bcn 1";
+
+	enum class Format
+	{
+		BC1, // RGB
+		BC3, // RGBA
+		BC4, // R
+		BC5  // RG
+	};
+
+	// Format for images with this many channels
+	Format formatFor(int components);
+	GLenum internalFormat(Format format);
+	GLenum baseFormat(Format format);
+	size_t blockBytes(Format format);
+	size_t compressedSize(Format format, int width, int height);
+
+	// Compresses one image. pixels are tightly packed rows of components
+	// bytes, output needs compressedSize bytes. parallel splits the rows of
+	// blocks across the worker pool and waits, so only pass it from
+	// outside the pool.
+	void compress(const unsigned char* pixels, int width, int height, int components,
+		Format format, unsigned char* output, bool parallel);
+}
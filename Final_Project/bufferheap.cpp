@@ -0,0 +1,332 @@
+/*
+* bufferheap.cpp
+* This file contains implementations for the shared vertex and index buffer heap
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "bufferheap.h"
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+#include <vector>
+#include "glstate.h"
+#include "gpumem.h"
+
+namespace bufferheap
+{
+	std::list<Block> blocks;
+
+	// Helper functions
+
+	size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	Block& createBlock(unsigned int format, GLsizei stride, AttributeSetup attributes,
+		size_t vertexCount, size_t indexBytes)
+	{
+		size_t vertexCapacity = std::max(VERTEX_BLOCK_BYTES / stride, vertexCount);
+		size_t indexCapacity = std::max(INDEX_BLOCK_BYTES, indexBytes);
+		blocks.push_back(Block{ vertexCapacity, indexCapacity });
+		Block& block = blocks.back();
+		block.format = format;
+		block.stride = stride;
+
+		glGenVertexArrays(1, &block.VAO);
+		glGenBuffers(1, &block.VBO);
+		glGenBuffers(1, &block.EBO);
+		glstate::bindVertexArray(block.VAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, block.VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertexCapacity * stride, NULL, GL_STATIC_DRAW);
+		gpumem::trackPool(block.VBO, gpumem::Kind::Vertex, vertexCapacity * stride, "bufferheap");
+		attributes();
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity, NULL, GL_STATIC_DRAW);
+		gpumem::trackPool(block.EBO, gpumem::Kind::Index, indexCapacity, "bufferheap");
+		return block;
+	}
+
+	// Copies the ranges to the front of a buffer through a temporary buffer,
+	// glCopyBufferSubData can't copy between overlapping ranges of one buffer
+	void compact(GLuint buffer, const std::vector<std::pair<size_t, size_t>>& ranges, size_t used)
+	{
+		if (used == 0)
+		{
+			return;
+		}
+		GLuint temporary;
+		glGenBuffers(1, &temporary);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, temporary);
+		glBufferData(GL_COPY_WRITE_BUFFER, used, NULL, GL_STREAM_COPY);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		size_t written = 0;
+		for (size_t i = 0; i < ranges.size(); i++)
+		{
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, ranges[i].first, written, ranges[i].second);
+			written += ranges[i].second;
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, temporary);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+		glDeleteBuffers(1, &temporary);
+	}
+
+	bool byVertex(const Allocation* a, const Allocation* b)
+	{
+		return a->baseVertex < b->baseVertex;
+	}
+
+	bool byIndex(const Allocation* a, const Allocation* b)
+	{
+		return a->indexOffset < b->indexOffset;
+	}
+
+	// RangeAllocator class
+	RangeAllocator::RangeAllocator(size_t uCapacity) : capacity{ uCapacity }
+	{
+		if (capacity > 0)
+		{
+			ranges[0] = capacity;
+		}
+	}
+
+	bool RangeAllocator::allocate(size_t size, size_t alignment, size_t& offset)
+	{
+		if (size == 0)
+		{
+			offset = 0;
+			return true;
+		}
+		std::map<size_t, size_t>::iterator it;
+		for (it = ranges.begin(); it != ranges.end(); it++)
+		{
+			size_t start = alignUp(it->first, alignment);
+			size_t end = it->first + it->second;
+			if (start + size > end)
+			{
+				continue;
+			}
+			// Splits the free range around the allocation
+			size_t rangeStart = it->first;
+			ranges.erase(it);
+			if (start > rangeStart)
+			{
+				ranges[rangeStart] = start - rangeStart;
+			}
+			if (start + size < end)
+			{
+				ranges[start + size] = end - start - size;
+			}
+			offset = start;
+			return true;
+		}
+		return false;
+	}
+
+	void RangeAllocator::free(size_t offset, size_t size)
+	{
+		if (size == 0)
+		{
+			return;
+		}
+		std::map<size_t, size_t>::iterator next = ranges.lower_bound(offset);
+		if (next != ranges.end() && offset + size == next->first)
+		{
+			size += next->second;
+			next = ranges.erase(next);
+		}
+		if (next != ranges.begin())
+		{
+			std::map<size_t, size_t>::iterator previous = std::prev(next);
+			if (previous->first + previous->second == offset)
+			{
+				previous->second += size;
+				return;
+			}
+		}
+		ranges[offset] = size;
+	}
+
+	void RangeAllocator::reset(size_t used)
+	{
+		ranges.clear();
+		if (used < capacity)
+		{
+			ranges[used] = capacity - used;
+		}
+	}
+
+	size_t RangeAllocator::freeSize() const
+	{
+		size_t total = 0;
+		std::map<size_t, size_t>::const_iterator it;
+		for (it = ranges.begin(); it != ranges.end(); it++)
+		{
+			total += it->second;
+		}
+		return total;
+	}
+
+	size_t RangeAllocator::largestFree() const
+	{
+		size_t largest = 0;
+		std::map<size_t, size_t>::const_iterator it;
+		for (it = ranges.begin(); it != ranges.end(); it++)
+		{
+			largest = std::max(largest, it->second);
+		}
+		return largest;
+	}
+
+	Allocation* allocate(unsigned int format, GLsizei stride, AttributeSetup attributes,
+		size_t vertexCount, size_t indexBytes)
+	{
+		indexBytes = alignUp(indexBytes, INDEX_ALIGNMENT);
+		Block* block = NULL;
+		size_t vertexOffset = 0;
+		size_t indexOffset = 0;
+		std::list<Block>::iterator it;
+		for (it = blocks.begin(); it != blocks.end() && block == NULL; it++)
+		{
+			if (it->format != format || it->vertices.largestFree() < vertexCount
+				|| it->indices.largestFree() < indexBytes)
+			{
+				continue;
+			}
+			it->vertices.allocate(vertexCount, 1, vertexOffset);
+			it->indices.allocate(indexBytes, INDEX_ALIGNMENT, indexOffset);
+			block = &*it;
+		}
+		if (block == NULL)
+		{
+			block = &createBlock(format, stride, attributes, vertexCount, indexBytes);
+			block->vertices.allocate(vertexCount, 1, vertexOffset);
+			block->indices.allocate(indexBytes, INDEX_ALIGNMENT, indexOffset);
+		}
+
+		Allocation allocation;
+		allocation.block = block;
+		allocation.VAO = block->VAO;
+		allocation.VBO = block->VBO;
+		allocation.EBO = block->EBO;
+		allocation.baseVertex = (GLint)vertexOffset;
+		allocation.vertexCount = vertexCount;
+		allocation.indexOffset = indexOffset;
+		allocation.indexBytes = indexBytes;
+		block->allocations.push_back(allocation);
+
+		// The ranges go to the caller's owner. The allocation's address
+		// identifies them, defragment moves the offsets but not the node.
+		Allocation* result = &block->allocations.back();
+		gpumem::trackRange(block->VBO, gpumem::Kind::Vertex, (size_t)result, vertexCount * block->stride);
+		gpumem::trackRange(block->EBO, gpumem::Kind::Index, (size_t)result, indexBytes);
+		return result;
+	}
+
+	void free(Allocation* allocation)
+	{
+		if (allocation == NULL)
+		{
+			return;
+		}
+		Block* block = allocation->block;
+		gpumem::releaseRange(block->VBO, gpumem::Kind::Vertex, (size_t)allocation);
+		gpumem::releaseRange(block->EBO, gpumem::Kind::Index, (size_t)allocation);
+		block->vertices.free(allocation->baseVertex, allocation->vertexCount);
+		block->indices.free(allocation->indexOffset, allocation->indexBytes);
+		std::list<Allocation>::iterator it;
+		for (it = block->allocations.begin(); it != block->allocations.end(); it++)
+		{
+			if (&*it == allocation)
+			{
+				block->allocations.erase(it);
+				break;
+			}
+		}
+	}
+
+	void defragment()
+	{
+		std::list<Block>::iterator it;
+		for (it = blocks.begin(); it != blocks.end(); it++)
+		{
+			Block& block = *it;
+			std::vector<Allocation*> live;
+			std::list<Allocation>::iterator a;
+			for (a = block.allocations.begin(); a != block.allocations.end(); a++)
+			{
+				live.push_back(&*a);
+			}
+
+			// Vertices, in order of their current position
+			std::sort(live.begin(), live.end(), byVertex);
+			std::vector<std::pair<size_t, size_t>> ranges;
+			size_t used = 0;
+			for (size_t i = 0; i < live.size(); i++)
+			{
+				ranges.push_back(std::make_pair((size_t)live[i]->baseVertex * block.stride,
+					live[i]->vertexCount * block.stride));
+				live[i]->baseVertex = (GLint)used;
+				used += live[i]->vertexCount;
+			}
+			compact(block.VBO, ranges, used * block.stride);
+			block.vertices.reset(used);
+
+			// Indices, sizes are already multiples of INDEX_ALIGNMENT
+			std::sort(live.begin(), live.end(), byIndex);
+			ranges.clear();
+			used = 0;
+			for (size_t i = 0; i < live.size(); i++)
+			{
+				ranges.push_back(std::make_pair(live[i]->indexOffset, live[i]->indexBytes));
+				live[i]->indexOffset = used;
+				used += live[i]->indexBytes;
+			}
+			compact(block.EBO, ranges, used);
+			block.indices.reset(used);
+		}
+	}
+
+	void clear()
+	{
+		std::list<Block>::iterator it;
+		for (it = blocks.begin(); it != blocks.end(); it++)
+		{
+			glDeleteVertexArrays(1, &it->VAO);
+			glstate::deletedVertexArray(it->VAO);
+			glDeleteBuffers(1, &it->VBO);
+			glDeleteBuffers(1, &it->EBO);
+			gpumem::release(it->VBO, gpumem::Kind::Vertex);
+			gpumem::release(it->EBO, gpumem::Kind::Index);
+		}
+		blocks.clear();
+	}
+
+	void report(std::ostream& out)
+	{
+		out << "---- Buffer heap: " << blocks.size() << " blocks ----" << std::endl;
+		std::list<Block>::iterator it;
+		for (it = blocks.begin(); it != blocks.end(); it++)
+		{
+			const Block& block = *it;
+			out << "  format " << block.format << std::fixed << std::setprecision(1)
+				<< "  meshes " << std::setw(5) << block.allocations.size()
+				<< "  vertices " << std::setw(8) << (block.vertices.capacity - block.vertices.freeSize()) * block.stride / 1024.0
+				<< " / " << block.vertices.capacity * block.stride / 1024.0 << " KiB"
+				<< "  indices " << std::setw(8) << (block.indices.capacity - block.indices.freeSize()) / 1024.0
+				<< " / " << block.indices.capacity / 1024.0 << " KiB"
+				<< "  largest free " << block.vertices.largestFree() << " vertices" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,93 @@
+/*
+* bufferheap.h
+* This file contains declarations for the shared vertex and index buffer heap
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <iostream>
+#include <list>
+#include <map>
+
+// Meshes don't own GL buffers. Each vertex format gets a few large blocks,
+// each a VBO and an EBO with one VAO over both, and meshes get ranges of
+// them. Meshes in one block draw from the same VAO with a base vertex
+// offset, so switching between them needs no new vertex setup.
+
+namespace bufferheap
+{
+	// Default block sizes, larger meshes get a block of their own size
+	const size_t VERTEX_BLOCK_BYTES = 16 * 1024 * 1024;
+	const size_t INDEX_BLOCK_BYTES = 8 * 1024 * 1024;
+	// Index ranges start on 4 bytes so any index type can use them
+	const size_t INDEX_ALIGNMENT = 4;
+
+	// Sets the vertex attributes of the bound VAO for vertices that start
+	// at offset zero of the bound GL_ARRAY_BUFFER
+	typedef void (*AttributeSetup)();
+
+	// Free ranges of one buffer. Allocates first fit and merges neighbouring
+	// ranges when they are freed. Units are up to the caller.
+	class RangeAllocator
+	{
+	public:
+		size_t capacity;
+		RangeAllocator(size_t uCapacity);
+		bool allocate(size_t size, size_t alignment, size_t& offset);
+		void free(size_t offset, size_t size);
+		// Marks everything from used to the end as the only free range
+		void reset(size_t used);
+		size_t freeSize() const;
+		size_t largestFree() const;
+	private:
+		std::map<size_t, size_t> ranges; // offset to size
+	};
+
+	struct Block;
+
+	// A mesh's ranges of a block. defragment moves the ranges, so read the
+	// offsets when drawing instead of keeping copies.
+	struct Allocation
+	{
+		Block* block;
+		GLuint VAO, VBO, EBO;
+		GLint baseVertex;   // first vertex, for glDrawElementsBaseVertex
+		size_t vertexCount;
+		size_t indexOffset; // in bytes
+		size_t indexBytes;
+	};
+
+	struct Block
+	{
+		unsigned int format;
+		GLsizei stride;
+		GLuint VAO, VBO, EBO;
+		RangeAllocator vertices; // in vertices
+		RangeAllocator indices;  // in bytes
+		std::list<Allocation> allocations;
+		Block(size_t vertexCapacity, size_t indexCapacity) : format{ 0 }, stride{ 0 }, VAO{ 0 }, VBO{ 0 }, EBO{ 0 },
+			vertices{ vertexCapacity }, indices{ indexCapacity } {}
+	};
+
+	// Reserves vertexCount vertices and indexBytes of indices in one block of
+	// the format, creating a block when none has room. Every caller passing
+	// the same format must pass the same stride and attributes.
+	Allocation* allocate(unsigned int format, GLsizei stride, AttributeSetup attributes,
+		size_t vertexCount, size_t indexBytes);
+	void free(Allocation* allocation);
+	// Moves each block's ranges to the front of its buffers, so its free
+	// space is one range again
+	void defragment();
+	// Deletes every block, all allocations are invalid afterwards
+	void clear();
+	void report(std::ostream& out);
+}
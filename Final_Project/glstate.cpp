@@ -0,0 +1,236 @@
+/*
+* glstate.cpp
+* This file contains definitions for skipping OpenGL state changes that change nothing
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "glstate.h"
+#include <iomanip>
+#include <map>
+#include <utility>
+
+namespace glstate
+{
+	// Not a valid name or enum, so the first request never matches
+	const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	const char* STATE_NAMES[(size_t)State::Count] = {
+		"program", "VAO", "texture", "activeTexture", "capability", "depthFunc", "instanceBuffer"
+	};
+
+	GLuint program = UNKNOWN;
+	GLuint vertexArray = UNKNOWN;
+	GLuint activeUnit = UNKNOWN;
+	GLenum depth = UNKNOWN;
+	// Keyed by (unit, target), missing entries are unknown
+	std::map<std::pair<GLuint, GLenum>, GLuint> textures;
+	// Missing entries are unknown
+	std::map<GLenum, bool> capabilities;
+	// Instance buffer and first matrix of each VAO, missing entries are unknown
+	std::map<GLuint, std::pair<GLuint, GLsizei>> instanceBuffers;
+	Counters totals;
+
+	// Helper functions
+
+	// Counts the request, returns true when GL has to be called
+	bool changes(State state, GLuint& shadow, GLuint value)
+	{
+		totals.requested[(size_t)state]++;
+		if (shadow == value)
+		{
+			totals.elided[(size_t)state]++;
+			return false;
+		}
+		shadow = value;
+		return true;
+	}
+
+	void setCapability(GLenum capability, bool enabled)
+	{
+		totals.requested[(size_t)State::Capability]++;
+		std::map<GLenum, bool>::iterator it = capabilities.find(capability);
+		if (it != capabilities.end() && it->second == enabled)
+		{
+			totals.elided[(size_t)State::Capability]++;
+			return;
+		}
+		capabilities[capability] = enabled;
+		if (enabled)
+		{
+			glEnable(capability);
+		}
+		else
+		{
+			glDisable(capability);
+		}
+	}
+
+	// Counters struct
+	Counters::Counters()
+	{
+		for (size_t i = 0; i < (size_t)State::Count; i++)
+		{
+			requested[i] = 0;
+			elided[i] = 0;
+		}
+	}
+
+	void useProgram(GLuint uProgram)
+	{
+		if (changes(State::Program, program, uProgram))
+		{
+			glUseProgram(uProgram);
+		}
+	}
+
+	void bindVertexArray(GLuint uVertexArray)
+	{
+		if (changes(State::VertexArray, vertexArray, uVertexArray))
+		{
+			glBindVertexArray(uVertexArray);
+		}
+	}
+
+	void bindTexture(GLuint unit, GLenum target, GLuint texture)
+	{
+		std::pair<GLuint, GLenum> key{ unit, target };
+		std::map<std::pair<GLuint, GLenum>, GLuint>::iterator it = textures.find(key);
+		GLuint bound = (it == textures.end()) ? UNKNOWN : it->second;
+		if (!changes(State::Texture, bound, texture))
+		{
+			return;
+		}
+		textures[key] = texture;
+		if (changes(State::ActiveTexture, activeUnit, unit))
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+		}
+		glBindTexture(target, texture);
+	}
+
+	void enable(GLenum capability)
+	{
+		setCapability(capability, true);
+	}
+
+	void disable(GLenum capability)
+	{
+		setCapability(capability, false);
+	}
+
+	void depthFunc(GLenum func)
+	{
+		if (changes(State::DepthFunc, depth, func))
+		{
+			glDepthFunc(func);
+		}
+	}
+
+	void instanceBuffer(GLuint location, GLuint buffer, GLsizei first)
+	{
+		std::pair<GLuint, GLsizei> binding{ buffer, first };
+		totals.requested[(size_t)State::InstanceBuffer]++;
+		if (vertexArray != UNKNOWN)
+		{
+			std::map<GLuint, std::pair<GLuint, GLsizei>>::iterator it = instanceBuffers.find(vertexArray);
+			if (it != instanceBuffers.end() && it->second == binding)
+			{
+				totals.elided[(size_t)State::InstanceBuffer]++;
+				return;
+			}
+			instanceBuffers[vertexArray] = binding;
+		}
+
+		// One vec4 column per location
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		for (GLuint column = 0; column < 4; column++)
+		{
+			glVertexAttribPointer(location + column, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(GLfloat),
+				(void*)(((size_t)first * 16 + column * 4) * sizeof(GLfloat)));
+		}
+	}
+
+	void deletedVertexArray(GLuint uVertexArray)
+	{
+		instanceBuffers.erase(uVertexArray);
+		if (vertexArray == uVertexArray)
+		{
+			vertexArray = 0;
+		}
+	}
+
+	void deletedTexture(GLuint texture)
+	{
+		std::map<std::pair<GLuint, GLenum>, GLuint>::iterator it;
+		for (it = textures.begin(); it != textures.end(); it++)
+		{
+			if (it->second == texture)
+			{
+				it->second = 0;
+			}
+		}
+	}
+
+	void deletedBuffer(GLuint buffer)
+	{
+		std::map<GLuint, std::pair<GLuint, GLsizei>>::iterator it = instanceBuffers.begin();
+		while (it != instanceBuffers.end())
+		{
+			if (it->second.first == buffer)
+			{
+				it = instanceBuffers.erase(it);
+			}
+			else
+			{
+				it++;
+			}
+		}
+	}
+
+	void reset()
+	{
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		activeUnit = UNKNOWN;
+		depth = UNKNOWN;
+		textures.clear();
+		capabilities.clear();
+		instanceBuffers.clear();
+	}
+
+	const Counters& counters()
+	{
+		return totals;
+	}
+
+	void resetCounters()
+	{
+		totals = Counters();
+	}
+
+	void report(std::ostream& out)
+	{
+		out << "state           requested    elided" << std::endl;
+		unsigned long requested = 0;
+		unsigned long elided = 0;
+		for (size_t i = 0; i < (size_t)State::Count; i++)
+		{
+			out << std::left << std::setw(14) << STATE_NAMES[i] << std::right
+				<< std::setw(11) << totals.requested[i]
+				<< std::setw(10) << totals.elided[i] << std::endl;
+			requested += totals.requested[i];
+			elided += totals.elided[i];
+		}
+		out << std::left << std::setw(14) << "TOTAL" << std::right
+			<< std::setw(11) << requested
+			<< std::setw(10) << elided << std::endl;
+	}
+}
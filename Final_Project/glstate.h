@@ -0,0 +1,72 @@
+/*
+* glstate.h
+* This file contains declarations for skipping OpenGL state changes that change nothing
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <iostream>
+
+// Keeps a shadow copy of the bound program, VAO, textures per unit, the
+// active unit, capabilities, the depth function and each VAO's instance
+// buffer, and only calls GL when a request differs from it. Every bind in the renderer goes through here,
+// a direct glBind* call leaves the shadow wrong until reset(). Everything
+// starts unknown, so the first request for each piece of state is issued.
+
+namespace glstate
+{
+	enum class State
+	{
+		Program,
+		VertexArray,
+		Texture,
+		ActiveTexture,
+		Capability,
+		DepthFunc,
+		InstanceBuffer,
+		Count
+	};
+
+	// Requests per kind of state and how many of them were skipped
+	struct Counters
+	{
+		unsigned long requested[(size_t)State::Count];
+		unsigned long elided[(size_t)State::Count];
+		Counters();
+	};
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+	// Makes unit active when the binding has to change
+	void bindTexture(GLuint unit, GLenum target, GLuint texture);
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void depthFunc(GLenum func);
+	// Points the mat4 attribute at location, and the three after it, of the
+	// bound VAO at buffer, starting from matrix first. The shadow is kept per
+	// VAO, since VAOs shared between models get pointed at each model's
+	// buffer in turn. GL 3.3 has no base instance, so ranges of one buffer
+	// are drawn by moving the pointers.
+	void instanceBuffer(GLuint location, GLuint buffer, GLsizei first = 0);
+
+	// GL unbinds deleted objects, the shadow has to follow
+	void deletedVertexArray(GLuint vertexArray);
+	void deletedTexture(GLuint texture);
+	// VAOs keep a deleted buffer alive, its name may come back as a new buffer
+	void deletedBuffer(GLuint buffer);
+
+	// Forgets everything, call after making a new context current
+	void reset();
+	const Counters& counters();
+	void resetCounters();
+	void report(std::ostream& out);
+}
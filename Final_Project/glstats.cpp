@@ -0,0 +1,419 @@
+/*
+* glstats.cpp
+* This file contains implementations for counting OpenGL calls per frame
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "glstats.h"
+
+namespace glstats
+{
+	// --------------- STATE ---------------
+	bool isInstalled = false;
+	const char* currentCaller = "other";
+	const char* resolvedCaller = NULL;
+	Counters* resolvedCounters = NULL;
+	FrameStats currentFrame;
+	FrameStats finishedFrame;
+
+	// Counters of the current caller, the map is only searched when the caller changes
+	Counters& counters()
+	{
+		if (currentCaller != resolvedCaller)
+		{
+			resolvedCounters = &currentFrame.callers[currentCaller];
+			resolvedCaller = currentCaller;
+		}
+		return *resolvedCounters;
+	}
+
+	// Size of one pixel of client data
+	unsigned long long pixelBytes(GLenum format, GLenum type)
+	{
+		unsigned long long components = 4;
+		switch (format)
+		{
+		case GL_RED: case GL_DEPTH_COMPONENT: components = 1; break;
+		case GL_RG: components = 2; break;
+		case GL_RGB: case GL_BGR: components = 3; break;
+		}
+
+		unsigned long long size = 1;
+		switch (type)
+		{
+		case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: size = 2; break;
+		case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: size = 4; break;
+		}
+		return components * size;
+	}
+
+	void Counters::add(const Counters& other)
+	{
+		drawCalls += other.drawCalls;
+		useProgram += other.useProgram;
+		bindTexture += other.bindTexture;
+		bindVertexArray += other.bindVertexArray;
+		getUniformLocation += other.getUniformLocation;
+		uniformUploads += other.uniformUploads;
+		bufferBytes += other.bufferBytes;
+		textureBytes += other.textureBytes;
+	}
+
+	// --------------- DRIVER FUNCTIONS ---------------
+	PFNGLDRAWELEMENTSPROC realDrawElements;
+	PFNGLDRAWARRAYSPROC realDrawArrays;
+	PFNGLDRAWELEMENTSBASEVERTEXPROC realDrawElementsBaseVertex;
+	PFNGLDRAWELEMENTSINSTANCEDPROC realDrawElementsInstanced;
+	PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXPROC realDrawElementsInstancedBaseVertex;
+	PFNGLUSEPROGRAMPROC realUseProgram;
+	PFNGLBINDTEXTUREPROC realBindTexture;
+	PFNGLBINDVERTEXARRAYPROC realBindVertexArray;
+	PFNGLGETUNIFORMLOCATIONPROC realGetUniformLocation;
+	PFNGLUNIFORM1IPROC realUniform1i;
+	PFNGLUNIFORM1FPROC realUniform1f;
+	PFNGLUNIFORM3FVPROC realUniform3fv;
+	PFNGLUNIFORM4FPROC realUniform4f;
+	PFNGLUNIFORM4FVPROC realUniform4fv;
+	PFNGLUNIFORMMATRIX4FVPROC realUniformMatrix4fv;
+	PFNGLBUFFERDATAPROC realBufferData;
+	PFNGLBUFFERSUBDATAPROC realBufferSubData;
+	PFNGLMAPBUFFERRANGEPROC realMapBufferRange;
+	PFNGLTEXIMAGE2DPROC realTexImage2D;
+	PFNGLTEXSUBIMAGE2DPROC realTexSubImage2D;
+	PFNGLTEXIMAGE3DPROC realTexImage3D;
+	PFNGLTEXSUBIMAGE3DPROC realTexSubImage3D;
+	PFNGLCOMPRESSEDTEXIMAGE2DPROC realCompressedTexImage2D;
+	PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC realCompressedTexSubImage3D;
+
+	// --------------- COUNTING WRAPPERS ---------------
+	void APIENTRY countDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+	{
+		counters().drawCalls++;
+		realDrawElements(mode, count, type, indices);
+	}
+
+	void APIENTRY countDrawArrays(GLenum mode, GLint first, GLsizei count)
+	{
+		counters().drawCalls++;
+		realDrawArrays(mode, first, count);
+	}
+
+	void APIENTRY countDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex)
+	{
+		counters().drawCalls++;
+		realDrawElementsBaseVertex(mode, count, type, indices, basevertex);
+	}
+
+	void APIENTRY countDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount)
+	{
+		counters().drawCalls++;
+		realDrawElementsInstanced(mode, count, type, indices, instancecount);
+	}
+
+	void APIENTRY countDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices,
+		GLsizei instancecount, GLint basevertex)
+	{
+		counters().drawCalls++;
+		realDrawElementsInstancedBaseVertex(mode, count, type, indices, instancecount, basevertex);
+	}
+
+	void APIENTRY countUseProgram(GLuint program)
+	{
+		counters().useProgram++;
+		realUseProgram(program);
+	}
+
+	void APIENTRY countBindTexture(GLenum target, GLuint texture)
+	{
+		counters().bindTexture++;
+		realBindTexture(target, texture);
+	}
+
+	void APIENTRY countBindVertexArray(GLuint array)
+	{
+		counters().bindVertexArray++;
+		realBindVertexArray(array);
+	}
+
+	GLint APIENTRY countGetUniformLocation(GLuint program, const GLchar* name)
+	{
+		counters().getUniformLocation++;
+		return realGetUniformLocation(program, name);
+	}
+
+	void APIENTRY countUniform1i(GLint location, GLint v0)
+	{
+		counters().uniformUploads++;
+		realUniform1i(location, v0);
+	}
+
+	void APIENTRY countUniform1f(GLint location, GLfloat v0)
+	{
+		counters().uniformUploads++;
+		realUniform1f(location, v0);
+	}
+
+	void APIENTRY countUniform3fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		counters().uniformUploads++;
+		realUniform3fv(location, count, value);
+	}
+
+	void APIENTRY countUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+	{
+		counters().uniformUploads++;
+		realUniform4f(location, v0, v1, v2, v3);
+	}
+
+	void APIENTRY countUniform4fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		counters().uniformUploads++;
+		realUniform4fv(location, count, value);
+	}
+
+	void APIENTRY countUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+	{
+		counters().uniformUploads++;
+		realUniformMatrix4fv(location, count, transpose, value);
+	}
+
+	void APIENTRY countBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+	{
+		if (data)
+		{
+			counters().bufferBytes += size;
+		}
+		realBufferData(target, size, data, usage);
+	}
+
+	void APIENTRY countBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+	{
+		counters().bufferBytes += size;
+		realBufferSubData(target, offset, size, data);
+	}
+
+	void* APIENTRY countMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+	{
+		// Bytes written through a mapping count as uploaded
+		if (access & GL_MAP_WRITE_BIT)
+		{
+			counters().bufferBytes += length;
+		}
+		return realMapBufferRange(target, offset, length, access);
+	}
+
+	void APIENTRY countTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+		GLint border, GLenum format, GLenum type, const void* pixels)
+	{
+		if (pixels)
+		{
+			counters().textureBytes += width * height * pixelBytes(format, type);
+		}
+		realTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	}
+
+	void APIENTRY countTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+		GLsizei height, GLenum format, GLenum type, const void* pixels)
+	{
+		counters().textureBytes += width * height * pixelBytes(format, type);
+		realTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+	}
+
+	void APIENTRY countTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+		GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels)
+	{
+		if (pixels)
+		{
+			counters().textureBytes += width * height * depth * pixelBytes(format, type);
+		}
+		realTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+	}
+
+	void APIENTRY countTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+	{
+		counters().textureBytes += width * height * depth * pixelBytes(format, type);
+		realTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+	}
+
+	void APIENTRY countCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width,
+		GLsizei height, GLint border, GLsizei imageSize, const void* data)
+	{
+		counters().textureBytes += imageSize;
+		realCompressedTexImage2D(target, level, internalformat, width, height, border, imageSize, data);
+	}
+
+	// Compressed layers of texture arrays, imageSize is already the uploaded size
+	void APIENTRY countCompressedTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void* data)
+	{
+		counters().textureBytes += imageSize;
+		realCompressedTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, data);
+	}
+
+	// --------------- INSTALL ---------------
+	void install()
+	{
+		if (isInstalled)
+		{
+			return;
+		}
+
+		realDrawElements = glad_glDrawElements;
+		realDrawArrays = glad_glDrawArrays;
+		realDrawElementsBaseVertex = glad_glDrawElementsBaseVertex;
+		realDrawElementsInstanced = glad_glDrawElementsInstanced;
+		realDrawElementsInstancedBaseVertex = glad_glDrawElementsInstancedBaseVertex;
+		realUseProgram = glad_glUseProgram;
+		realBindTexture = glad_glBindTexture;
+		realBindVertexArray = glad_glBindVertexArray;
+		realGetUniformLocation = glad_glGetUniformLocation;
+		realUniform1i = glad_glUniform1i;
+		realUniform1f = glad_glUniform1f;
+		realUniform3fv = glad_glUniform3fv;
+		realUniform4f = glad_glUniform4f;
+		realUniform4fv = glad_glUniform4fv;
+		realUniformMatrix4fv = glad_glUniformMatrix4fv;
+		realBufferData = glad_glBufferData;
+		realBufferSubData = glad_glBufferSubData;
+		realMapBufferRange = glad_glMapBufferRange;
+		realTexImage2D = glad_glTexImage2D;
+		realTexSubImage2D = glad_glTexSubImage2D;
+		realTexImage3D = glad_glTexImage3D;
+		realTexSubImage3D = glad_glTexSubImage3D;
+		realCompressedTexImage2D = glad_glCompressedTexImage2D;
+		realCompressedTexSubImage3D = glad_glCompressedTexSubImage3D;
+
+		glad_glDrawElements = countDrawElements;
+		glad_glDrawArrays = countDrawArrays;
+		glad_glDrawElementsBaseVertex = countDrawElementsBaseVertex;
+		glad_glDrawElementsInstanced = countDrawElementsInstanced;
+		glad_glDrawElementsInstancedBaseVertex = countDrawElementsInstancedBaseVertex;
+		glad_glUseProgram = countUseProgram;
+		glad_glBindTexture = countBindTexture;
+		glad_glBindVertexArray = countBindVertexArray;
+		glad_glGetUniformLocation = countGetUniformLocation;
+		glad_glUniform1i = countUniform1i;
+		glad_glUniform1f = countUniform1f;
+		glad_glUniform3fv = countUniform3fv;
+		glad_glUniform4f = countUniform4f;
+		glad_glUniform4fv = countUniform4fv;
+		glad_glUniformMatrix4fv = countUniformMatrix4fv;
+		glad_glBufferData = countBufferData;
+		glad_glBufferSubData = countBufferSubData;
+		glad_glMapBufferRange = countMapBufferRange;
+		glad_glTexImage2D = countTexImage2D;
+		glad_glTexSubImage2D = countTexSubImage2D;
+		glad_glTexImage3D = countTexImage3D;
+		glad_glTexSubImage3D = countTexSubImage3D;
+		glad_glCompressedTexImage2D = countCompressedTexImage2D;
+		glad_glCompressedTexSubImage3D = countCompressedTexSubImage3D;
+
+		isInstalled = true;
+	}
+
+	void uninstall()
+	{
+		if (!isInstalled)
+		{
+			return;
+		}
+
+		glad_glDrawElements = realDrawElements;
+		glad_glDrawArrays = realDrawArrays;
+		glad_glDrawElementsBaseVertex = realDrawElementsBaseVertex;
+		glad_glDrawElementsInstanced = realDrawElementsInstanced;
+		glad_glDrawElementsInstancedBaseVertex = realDrawElementsInstancedBaseVertex;
+		glad_glUseProgram = realUseProgram;
+		glad_glBindTexture = realBindTexture;
+		glad_glBindVertexArray = realBindVertexArray;
+		glad_glGetUniformLocation = realGetUniformLocation;
+		glad_glUniform1i = realUniform1i;
+		glad_glUniform1f = realUniform1f;
+		glad_glUniform3fv = realUniform3fv;
+		glad_glUniform4f = realUniform4f;
+		glad_glUniform4fv = realUniform4fv;
+		glad_glUniformMatrix4fv = realUniformMatrix4fv;
+		glad_glBufferData = realBufferData;
+		glad_glBufferSubData = realBufferSubData;
+		glad_glMapBufferRange = realMapBufferRange;
+		glad_glTexImage2D = realTexImage2D;
+		glad_glTexSubImage2D = realTexSubImage2D;
+		glad_glTexImage3D = realTexImage3D;
+		glad_glTexSubImage3D = realTexSubImage3D;
+		glad_glCompressedTexImage2D = realCompressedTexImage2D;
+		glad_glCompressedTexSubImage3D = realCompressedTexSubImage3D;
+
+		isInstalled = false;
+	}
+
+	bool installed()
+	{
+		return isInstalled;
+	}
+
+	// --------------- FRAMES ---------------
+	void beginFrame()
+	{
+		currentFrame = FrameStats();
+		resolvedCaller = NULL;
+	}
+
+	void endFrame()
+	{
+		std::map<std::string, Counters>::iterator it;
+		for (it = currentFrame.callers.begin(); it != currentFrame.callers.end(); it++)
+		{
+			currentFrame.total.add(it->second);
+		}
+		finishedFrame = currentFrame;
+	}
+
+	const FrameStats& lastFrame()
+	{
+		return finishedFrame;
+	}
+
+	void report(std::ostream& out, const FrameStats& stats)
+	{
+		out << "caller                   draws  programs  textures      VAOs  uniLocs  uniforms  bufBytes  texBytes" << std::endl;
+
+		std::map<std::string, Counters> rows = stats.callers;
+		rows["TOTAL"] = stats.total;
+		std::map<std::string, Counters>::iterator it;
+		for (it = rows.begin(); it != rows.end(); it++)
+		{
+			const Counters& c = it->second;
+			out.width(22);
+			out << std::left << it->first << std::right;
+			out.width(8); out << c.drawCalls;
+			out.width(10); out << c.useProgram;
+			out.width(10); out << c.bindTexture;
+			out.width(10); out << c.bindVertexArray;
+			out.width(9); out << c.getUniformLocation;
+			out.width(10); out << c.uniformUploads;
+			out.width(10); out << c.bufferBytes;
+			out.width(10); out << c.textureBytes << std::endl;
+		}
+	}
+
+	// ScopedCaller class
+	ScopedCaller::ScopedCaller(const char* name)
+	{
+		previous = currentCaller;
+		currentCaller = name;
+	}
+
+	ScopedCaller::~ScopedCaller()
+	{
+		currentCaller = previous;
+	}
+}
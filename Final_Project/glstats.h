@@ -0,0 +1,70 @@
+/*
+* glstats.h
+* This file contains declarations for counting OpenGL calls per frame
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <iostream>
+#include <map>
+#include <string>
+
+// The counting layer swaps the glad function pointers for wrappers that count
+// and then forward to the driver. Until install() is called nothing is
+// swapped, so the only cost left in the renderer is setting the caller name.
+
+namespace glstats
+{
+	struct Counters
+	{
+		unsigned long drawCalls;
+		unsigned long useProgram;
+		unsigned long bindTexture;
+		unsigned long bindVertexArray;
+		unsigned long getUniformLocation;
+		unsigned long uniformUploads;
+		unsigned long long bufferBytes;
+		unsigned long long textureBytes;
+		Counters() : drawCalls{ 0 }, useProgram{ 0 }, bindTexture{ 0 }, bindVertexArray{ 0 },
+			getUniformLocation{ 0 }, uniformUploads{ 0 }, bufferBytes{ 0 }, textureBytes{ 0 } {}
+		void add(const Counters& other);
+	};
+
+	// Counters of one frame, in total and split by the code that made the calls
+	struct FrameStats
+	{
+		Counters total;
+		std::map<std::string, Counters> callers;
+	};
+
+	// Installs the counting wrappers, must be called after GLAD is loaded
+	void install();
+	// Restores the original glad function pointers
+	void uninstall();
+	bool installed();
+
+	void beginFrame();
+	void endFrame();
+	// Counters of the last finished frame
+	const FrameStats& lastFrame();
+	void report(std::ostream& out, const FrameStats& stats);
+
+	// Attributes every call made in its lifetime to the given caller
+	class ScopedCaller
+	{
+	public:
+		ScopedCaller(const char* name);
+		~ScopedCaller();
+	private:
+		const char* previous;
+	};
+}
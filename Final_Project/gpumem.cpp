@@ -0,0 +1,195 @@
+/*
+* gpumem.cpp
+* This file contains implementations for GPU memory accounting
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "gpumem.h"
+#include <iomanip>
+
+namespace gpumem
+{
+	// Buffers and textures have separate name spaces in OpenGL,
+	// so allocations are keyed by kind and name
+	std::map<std::pair<Kind, GLuint>, Allocation> allocations;
+	// Ranges of pools, keyed by kind, pool and the caller's key
+	typedef std::pair<std::pair<Kind, GLuint>, size_t> RangeKey;
+	std::map<RangeKey, Allocation> ranges;
+	std::string currentOwner = "unowned";
+
+	void trackBuffer(GLuint id, Kind kind, size_t bytes)
+	{
+		Allocation allocation;
+		allocation.kind = kind;
+		allocation.bytes = bytes;
+		allocation.owner = currentOwner;
+		allocation.pool = false;
+		allocations[std::make_pair(kind, id)] = allocation;
+	}
+
+	void trackPool(GLuint id, Kind kind, size_t bytes, const std::string& name)
+	{
+		Allocation allocation;
+		allocation.kind = kind;
+		allocation.bytes = bytes;
+		allocation.owner = name;
+		allocation.pool = true;
+		allocations[std::make_pair(kind, id)] = allocation;
+	}
+
+	void trackRange(GLuint pool, Kind kind, size_t key, size_t bytes, const std::string& path)
+	{
+		Allocation range;
+		range.kind = kind;
+		range.bytes = bytes;
+		range.owner = currentOwner;
+		range.path = path;
+		range.pool = false;
+		ranges[RangeKey(std::make_pair(kind, pool), key)] = range;
+	}
+
+	void releaseRange(GLuint pool, Kind kind, size_t key)
+	{
+		ranges.erase(RangeKey(std::make_pair(kind, pool), key));
+	}
+
+	void release(GLuint id, Kind kind)
+	{
+		std::pair<Kind, GLuint> object = std::make_pair(kind, id);
+		allocations.erase(object);
+		std::map<RangeKey, Allocation>::iterator it = ranges.lower_bound(RangeKey(object, 0));
+		while (it != ranges.end() && it->first.first == object)
+		{
+			it = ranges.erase(it);
+		}
+	}
+
+	size_t totalBytes()
+	{
+		size_t total = 0;
+		std::map<std::pair<Kind, GLuint>, Allocation>::iterator it;
+		for (it = allocations.begin(); it != allocations.end(); it++)
+		{
+			total += it->second.bytes;
+		}
+		return total;
+	}
+
+	std::map<std::string, size_t> bytesByOwner()
+	{
+		// Pools start out all unused, their ranges move bytes to the owners
+		std::map<std::string, size_t> owners;
+		std::map<std::pair<Kind, GLuint>, Allocation>::iterator it;
+		for (it = allocations.begin(); it != allocations.end(); it++)
+		{
+			owners[it->second.pool ? it->second.owner + " unused" : it->second.owner] += it->second.bytes;
+		}
+		std::map<RangeKey, Allocation>::iterator range;
+		for (range = ranges.begin(); range != ranges.end(); range++)
+		{
+			it = allocations.find(range->first.first);
+			if (it != allocations.end())
+			{
+				owners[it->second.owner + " unused"] -= range->second.bytes;
+			}
+			owners[range->second.owner] += range->second.bytes;
+		}
+		return owners;
+	}
+
+	std::map<std::string, size_t> bytesByTexture()
+	{
+		std::map<std::string, size_t> textures;
+		std::map<std::pair<Kind, GLuint>, Allocation>::iterator it;
+		for (it = allocations.begin(); it != allocations.end(); it++)
+		{
+			if (it->second.kind == Kind::Texture && !it->second.pool)
+			{
+				textures[it->second.path] += it->second.bytes;
+			}
+		}
+		std::map<RangeKey, Allocation>::iterator range;
+		for (range = ranges.begin(); range != ranges.end(); range++)
+		{
+			if (range->second.kind == Kind::Texture)
+			{
+				textures[range->second.path] += range->second.bytes;
+			}
+		}
+		return textures;
+	}
+
+	std::map<Kind, size_t> bytesByKind()
+	{
+		std::map<Kind, size_t> kinds;
+		std::map<std::pair<Kind, GLuint>, Allocation>::iterator it;
+		for (it = allocations.begin(); it != allocations.end(); it++)
+		{
+			kinds[it->second.kind] += it->second.bytes;
+		}
+		return kinds;
+	}
+
+	std::map<std::string, size_t> bytesByPool()
+	{
+		std::map<std::string, size_t> pools;
+		std::map<std::pair<Kind, GLuint>, Allocation>::iterator it;
+		for (it = allocations.begin(); it != allocations.end(); it++)
+		{
+			if (it->second.pool)
+			{
+				pools[it->second.owner] += it->second.bytes;
+			}
+		}
+		return pools;
+	}
+
+	// Prints one "name  KiB" line per entry
+	void printGroup(std::ostream& out, const char* title, const std::map<std::string, size_t>& group)
+	{
+		out << title << std::endl;
+		std::map<std::string, size_t>::const_iterator it;
+		for (it = group.begin(); it != group.end(); it++)
+		{
+			out << "  " << std::left << std::setw(44) << it->first << std::right
+				<< std::setw(12) << std::fixed << std::setprecision(1) << it->second / 1024.0 << " KiB" << std::endl;
+		}
+	}
+
+	void report(std::ostream& out)
+	{
+		std::map<Kind, size_t> kinds = bytesByKind();
+		std::map<std::string, size_t> kindNames;
+		kindNames["vertex buffers"] = kinds[Kind::Vertex];
+		kindNames["index buffers"] = kinds[Kind::Index];
+		kindNames["textures (with mip chain)"] = kinds[Kind::Texture];
+		kindNames["uniform buffers"] = kinds[Kind::Uniform];
+
+		out << "---- GPU memory: " << std::fixed << std::setprecision(1)
+			<< totalBytes() / (1024.0 * 1024.0) << " MiB in " << allocations.size() << " objects ----" << std::endl;
+		printGroup(out, "By type", kindNames);
+		printGroup(out, "By pool", bytesByPool());
+		printGroup(out, "By owner", bytesByOwner());
+		printGroup(out, "By texture", bytesByTexture());
+	}
+
+	// ScopedOwner class
+	ScopedOwner::ScopedOwner(const std::string& name)
+	{
+		previous = currentOwner;
+		currentOwner = name;
+	}
+
+	ScopedOwner::~ScopedOwner()
+	{
+		currentOwner = previous;
+	}
+}
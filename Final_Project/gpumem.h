@@ -0,0 +1,65 @@
+/*
+* gpumem.h
+* This file contains declarations for GPU memory accounting
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <iostream>
+#include <map>
+#include <string>
+
+namespace gpumem
+{
+	enum class Kind { Vertex, Index, Texture, Uniform };
+
+	struct Allocation
+	{
+		Kind kind;
+		size_t bytes;
+		std::string owner; // model path, or the mesh that made it
+		std::string path;  // source image of textures
+		bool pool;         // shared object whose ranges are tracked by their users
+	};
+
+	// Records a buffer or texture under the current owner
+	void trackBuffer(GLuint id, Kind kind, size_t bytes);
+	// Records an object that is handed out in ranges, e.g. a bufferheap
+	// block. It counts once in the totals, its ranges count by owner.
+	void trackPool(GLuint id, Kind kind, size_t bytes, const std::string& name);
+	// Records part of a pool under the current owner. key is anything unique
+	// within the pool that stays the same while the range lives.
+	void trackRange(GLuint pool, Kind kind, size_t key, size_t bytes, const std::string& path = "");
+	void releaseRange(GLuint pool, Kind kind, size_t key);
+	// Forgets an allocation when its GL object is deleted, and a pool's ranges with it
+	void release(GLuint id, Kind kind);
+
+	// Queries
+	size_t totalBytes();
+	// Ranges count under their owner, the unused part of each pool under "<pool> unused"
+	std::map<std::string, size_t> bytesByOwner();
+	std::map<std::string, size_t> bytesByTexture();
+	std::map<Kind, size_t> bytesByKind();
+	// Whole size of the pools, by pool name
+	std::map<std::string, size_t> bytesByPool();
+	void report(std::ostream& out);
+
+	// Attributes every allocation made in its lifetime to the given owner
+	class ScopedOwner
+	{
+	public:
+		ScopedOwner(const std::string& name);
+		~ScopedOwner();
+	private:
+		std::string previous;
+	};
+}
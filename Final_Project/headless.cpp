@@ -0,0 +1,204 @@
+/*
+* headless.cpp
+* This file contains implementations for windowless rendering
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "headless.h"
+#include "glstate.h"
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+namespace headless
+{
+#ifdef HEADLESS_EGL
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+
+	bool initialize(const unsigned int width, const unsigned int height)
+	{
+		// --------------- EGL INIT ---------------
+		// Prefers Mesa's surfaceless platform so no X or Wayland
+		// server is needed, falls back to the default display
+		// ----------------------------------------
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+		{
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		}
+		if (display == EGL_NO_DISPLAY)
+		{
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+		{
+			std::cout << "ERROR: failed to initialize EGL display" << std::endl;
+			return false;
+		}
+
+		const EGLint configAttributes[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE
+		};
+		EGLConfig config;
+		EGLint numConfigs = 0;
+		eglChooseConfig(display, configAttributes, &config, 1, &numConfigs);
+		if (numConfigs == 0)
+		{
+			std::cout << "ERROR: no EGL config supports desktop OpenGL" << std::endl;
+			return false;
+		}
+
+		// --------------- CONTEXT ---------------
+		// OpenGL 3.3 core profile to match the GLFW window
+		// ---------------------------------------
+		eglBindAPI(EGL_OPENGL_API);
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 3,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT)
+		{
+			std::cout << "ERROR: failed to create EGL context" << std::endl;
+			return false;
+		}
+
+		// Rendering goes to a framebuffer object so no surface is bound
+		if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		{
+			std::cout << "ERROR: failed to make EGL context current" << std::endl;
+			return false;
+		}
+
+		// -------------------- GLAD INIT --------------------
+		if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+		{
+			std::cout << "Error: failed to initialize GLAD" << std::endl;
+			return false;
+		}
+		// The shadowed state belonged to any previous context
+		glstate::reset();
+
+		return true;
+	}
+
+	void terminate()
+	{
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, context);
+		eglTerminate(display);
+	}
+#else
+	GLFWwindow* window = NULL;
+
+	bool initialize(const unsigned int width, const unsigned int height)
+	{
+		// --------------- GLFW INIT ---------------
+		// Same context settings as setup::initialize,
+		// but the window is never shown
+		// -----------------------------------------
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+		window = glfwCreateWindow(width, height, "Benchmark", NULL, NULL);
+		if (window == NULL)
+		{
+			std::cout << "ERROR: failed to create hidden GLFW window" << std::endl;
+			glfwTerminate();
+			return false;
+		}
+		glfwMakeContextCurrent(window);
+
+		// Never wait for vertical sync, there is nothing to present
+		glfwSwapInterval(0);
+
+		// -------------------- GLAD INIT --------------------
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Error: failed to initialize GLAD" << std::endl;
+			return false;
+		}
+		glstate::reset();
+
+		return true;
+	}
+
+	void terminate()
+	{
+		glfwTerminate();
+	}
+#endif
+
+	// Framebuffer class
+	Framebuffer::Framebuffer(const unsigned int uWidth, const unsigned int uHeight)
+	{
+		width = uWidth;
+		height = uHeight;
+
+		glGenFramebuffers(1, &FBO);
+		glGenRenderbuffers(1, &colorRBO);
+		glGenRenderbuffers(1, &depthRBO);
+
+		// Color attachment
+		glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+		// Depth attachment
+		glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "ERROR: offscreen framebuffer is not complete" << std::endl;
+		}
+
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	}
+
+	void Framebuffer::bind()
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glViewport(0, 0, width, height);
+	}
+
+	std::vector<unsigned char> Framebuffer::readPixels()
+	{
+		std::vector<unsigned char> pixels(width * height * 3);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+		return pixels;
+	}
+
+	void Framebuffer::destroy()
+	{
+		glDeleteRenderbuffers(1, &colorRBO);
+		glDeleteRenderbuffers(1, &depthRBO);
+		glDeleteFramebuffers(1, &FBO);
+	}
+}
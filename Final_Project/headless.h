@@ -0,0 +1,42 @@
+/*
+* headless.h
+* This file contains declarations for windowless rendering
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <iostream>
+#include <vector>
+
+// Define HEADLESS_EGL to create the context through EGL instead of a hidden
+// GLFW window. This is the path used on Linux machines without a display,
+// e.g. with Mesa's llvmpipe software rasterizer.
+
+namespace headless
+{
+	// Creates an OpenGL 3.3 core context with no visible window and loads GLAD
+	bool initialize(const unsigned int width, const unsigned int height);
+	void terminate();
+
+	// Offscreen render target with color and depth renderbuffers
+	class Framebuffer
+	{
+	public:
+		GLuint FBO, colorRBO, depthRBO;
+		unsigned int width, height;
+		Framebuffer(const unsigned int uWidth, const unsigned int uHeight);
+		void bind();
+		// Reads back the color buffer as tightly packed RGB rows, bottom row first
+		std::vector<unsigned char> readPixels();
+		void destroy();
+	};
+}
@@ -0,0 +1,274 @@
+/*
+* ktx.cpp
+* This file contains implementations for reading and writing KTX texture files
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+* File layout from the Khronos KTX 1.1 specification.
+*/
+
+#include "ktx.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace ktx
+{
+	const unsigned char IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const uint32_t ENDIANNESS = 0x04030201;
+	const std::string WRITER_KEY = "KTXwriter";
+
+	struct FileHeader
+	{
+		unsigned char identifier[12];
+		uint32_t endianness;
+		uint32_t glType;
+		uint32_t glTypeSize;
+		uint32_t glFormat;
+		uint32_t glInternalFormat;
+		uint32_t glBaseInternalFormat;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t numberOfArrayElements;
+		uint32_t numberOfFaces;
+		uint32_t numberOfMipmapLevels;
+		uint32_t bytesOfKeyValueData;
+	};
+
+	// Helper functions
+
+	// Workers decoding the same image, in this process or another, each
+	// write their own file, and whichever renames last wins
+	std::string temporaryPath(const std::string& path)
+	{
+		static std::atomic<unsigned int> written{ 0 };
+		std::ostringstream name;
+		name << path << "." << getpid() << "." << written++ << ".tmp";
+		return name.str();
+	}
+
+	size_t align4(size_t offset)
+	{
+		return (offset + 3) & ~(size_t)3;
+	}
+
+	// Bytes per row of uncompressed levels, zero for compressed ones
+	size_t rowBytes(const PixelFormat& format, GLsizei width)
+	{
+		if (format.type == 0)
+		{
+			return 0;
+		}
+		size_t components = 4;
+		switch (format.format)
+		{
+		case GL_RED: components = 1; break;
+		case GL_RG: components = 2; break;
+		case GL_RGB: components = 3; break;
+		}
+		return (size_t)width * components;
+	}
+
+	template <class T>
+	void writeValue(std::ofstream& out, const T& value)
+	{
+		out.write((const char*)&value, sizeof(T));
+	}
+
+	template <class T>
+	bool readValue(const std::vector<char>& file, size_t& offset, T& value)
+	{
+		if (offset + sizeof(T) > file.size())
+		{
+			return false;
+		}
+		std::memcpy(&value, file.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	bool write(const std::string& path, const PixelFormat& format,
+		const std::vector<Level>& levels, const std::string& writer)
+	{
+		if (levels.empty())
+		{
+			return false;
+		}
+		std::string temporary = temporaryPath(path);
+		std::ofstream out{ temporary, std::ios::binary | std::ios::trunc };
+		if (!out)
+		{
+			std::cout << "ERROR: failed to write texture cache " << path << std::endl;
+			return false;
+		}
+
+		// One key/value pair: key and value null terminated, padded to 4 bytes
+		uint32_t pairBytes = (uint32_t)(WRITER_KEY.size() + 1 + writer.size() + 1);
+		uint32_t keyValueBytes = (uint32_t)align4(sizeof(uint32_t) + pairBytes);
+
+		FileHeader header;
+		std::memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+		header.endianness = ENDIANNESS;
+		header.glType = format.type;
+		header.glTypeSize = 1;
+		header.glFormat = format.format;
+		header.glInternalFormat = format.internalFormat;
+		header.glBaseInternalFormat = format.baseFormat;
+		header.pixelWidth = levels.at(0).width;
+		header.pixelHeight = levels.at(0).height;
+		header.pixelDepth = 0;
+		header.numberOfArrayElements = 0;
+		header.numberOfFaces = 1;
+		header.numberOfMipmapLevels = (uint32_t)levels.size();
+		header.bytesOfKeyValueData = keyValueBytes;
+		writeValue(out, header);
+
+		const char zeros[4] = { 0, 0, 0, 0 };
+		writeValue(out, pairBytes);
+		out.write(WRITER_KEY.c_str(), WRITER_KEY.size() + 1);
+		out.write(writer.c_str(), writer.size() + 1);
+		out.write(zeros, keyValueBytes - sizeof(uint32_t) - pairBytes);
+
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			const Level& level = levels.at(i);
+			size_t row = rowBytes(format, level.width);
+			if (row == 0 || row % 4 == 0)
+			{
+				writeValue(out, (uint32_t)level.data.size());
+				out.write((const char*)level.data.data(), level.data.size());
+				out.write(zeros, align4(level.data.size()) - level.data.size());
+				continue;
+			}
+			// Uncompressed rows start on 4 bytes in the file
+			writeValue(out, (uint32_t)(align4(row) * level.height));
+			for (GLsizei y = 0; y < level.height; y++)
+			{
+				out.write((const char*)level.data.data() + y * row, row);
+				out.write(zeros, align4(row) - row);
+			}
+		}
+
+		bool written = (bool)out;
+		out.close();
+		if (!written)
+		{
+			std::cout << "ERROR: failed to write texture cache " << path << std::endl;
+			std::remove(temporary.c_str());
+			return false;
+		}
+		std::remove(path.c_str());
+		return std::rename(temporary.c_str(), path.c_str()) == 0;
+	}
+
+	bool read(const std::string& path, const std::string& writer,
+		PixelFormat& format, std::vector<Level>& levels)
+	{
+		std::ifstream in{ path, std::ios::binary };
+		if (!in)
+		{
+			return false;
+		}
+		std::vector<char> file{ std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+
+		size_t offset = 0;
+		FileHeader header;
+		if (!readValue(file, offset, header)
+			|| std::memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0
+			|| header.endianness != ENDIANNESS
+			|| (header.glType != 0 && header.glType != GL_UNSIGNED_BYTE)
+			|| header.pixelDepth != 0
+			|| header.numberOfArrayElements != 0
+			|| header.numberOfFaces != 1
+			|| header.numberOfMipmapLevels == 0
+			|| offset + header.bytesOfKeyValueData > file.size())
+		{
+			return false;
+		}
+
+		// Only files from this writer, older encoders' output is rebuilt
+		bool matched = false;
+		size_t keyValueEnd = offset + header.bytesOfKeyValueData;
+		while (offset < keyValueEnd)
+		{
+			uint32_t pairBytes = 0;
+			if (!readValue(file, offset, pairBytes) || offset + pairBytes > keyValueEnd)
+			{
+				return false;
+			}
+			std::string pair{ file.data() + offset, pairBytes };
+			size_t split = pair.find('\0');
+			if (split != std::string::npos && pair.substr(0, split) == WRITER_KEY)
+			{
+				std::string value = pair.substr(split + 1);
+				matched = value.c_str() == writer;
+			}
+			offset = align4(offset + pairBytes);
+		}
+		if (!matched)
+		{
+			return false;
+		}
+
+		format.type = header.glType;
+		format.format = header.glFormat;
+		format.internalFormat = header.glInternalFormat;
+		format.baseFormat = header.glBaseInternalFormat;
+
+		levels.clear();
+		GLsizei width = header.pixelWidth;
+		GLsizei height = header.pixelHeight;
+		for (uint32_t i = 0; i < header.numberOfMipmapLevels; i++)
+		{
+			uint32_t imageSize = 0;
+			if (!readValue(file, offset, imageSize) || offset + imageSize > file.size())
+			{
+				return false;
+			}
+			Level level;
+			level.width = width;
+			level.height = height;
+			size_t row = rowBytes(format, width);
+			if (row == 0 || row % 4 == 0)
+			{
+				level.data.assign(file.begin() + offset, file.begin() + offset + imageSize);
+			}
+			else if (imageSize == align4(row) * height)
+			{
+				for (GLsizei y = 0; y < height; y++)
+				{
+					std::vector<char>::const_iterator start = file.begin() + offset + y * align4(row);
+					level.data.insert(level.data.end(), start, start + row);
+				}
+			}
+			else
+			{
+				return false;
+			}
+			levels.push_back(level);
+			offset = align4(offset + imageSize);
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,48 @@
+/*
+* ktx.h
+* This file contains declarations for reading and writing KTX texture files
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+* File layout from the Khronos KTX 1.1 specification.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// KTX 1.1 files holding one 2D texture and its mip chain. Level data is
+// exactly what glCompressedTexImage2D or glTexImage2D takes with an unpack
+// alignment of 1, the 4 byte row padding of the file is added and removed
+// here. The writer's name goes in the KTXwriter key so stale files can be
+// told apart.
+
+namespace ktx
+{
+	struct Level
+	{
+		GLsizei width, height;
+		std::vector<unsigned char> data;
+	};
+
+	// type and format are zero for compressed textures
+	struct PixelFormat
+	{
+		GLenum type, format, internalFormat, baseFormat;
+	};
+
+	// Writes through a temporary file so a crash never leaves half a texture
+	bool write(const std::string& path, const PixelFormat& format,
+		const std::vector<Level>& levels, const std::string& writer);
+	// Fails on anything that isn't a 2D texture from this writer, or holds
+	// pixels that aren't unsigned bytes
+	bool read(const std::string& path, const std::string& writer,
+		PixelFormat& format, std::vector<Level>& levels);
+}
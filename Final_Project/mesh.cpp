@@ -13,12 +13,169 @@
 */
 
 #include "mesh.h"
+#include "meshopt.h"
+#include "profiler.h"
+#include "quantize.h"
+#include "texturearrays.h"
 
 namespace mesh
 {
+	// Helper functions
+
+	// Heap formats, one block layout per VertexFormat
+	void floatAttributes()
+	{
+		instanceAttributes();
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+		// vertex positions
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+		// vertex normals
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+		// vertex texture coords
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texture));
+	}
+
+	void packedAttributes()
+	{
+		instanceAttributes();
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+		// Normalized integers arrive in the shader as [0, 1] and [-1, 1]
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texture));
+	}
+
+	bufferheap::Allocation* allocate(VertexFormat format, size_t vertexCount, size_t indexBytes)
+	{
+		if (format == VertexFormat::Packed)
+		{
+			return bufferheap::allocate((unsigned int)format, sizeof(PackedVertex), packedAttributes, vertexCount, indexBytes);
+		}
+		return bufferheap::allocate((unsigned int)format, sizeof(Vertex), floatAttributes, vertexCount, indexBytes);
+	}
+
+	// Uploads into an allocation's ranges, null data is skipped
+	void upload(const bufferheap::Allocation* allocation, GLsizei stride, const void* vertexData,
+		const void* indexData, size_t indexBytes)
+	{
+		if (vertexData && allocation->vertexCount > 0)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, allocation->VBO);
+			glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)allocation->baseVertex * stride,
+				allocation->vertexCount * stride, vertexData);
+		}
+		if (indexData && indexBytes > 0)
+		{
+			// The element buffer binding is VAO state
+			glstate::bindVertexArray(allocation->VAO);
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, allocation->indexOffset, indexBytes, indexData);
+		}
+	}
+
+	GLenum indexType(size_t vertexCount)
+	{
+		if (vertexCount <= 0x100)
+		{
+			return GL_UNSIGNED_BYTE;
+		}
+		if (vertexCount <= 0x10000)
+		{
+			return GL_UNSIGNED_SHORT;
+		}
+		return GL_UNSIGNED_INT;
+	}
+
+	size_t indexSize(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_UNSIGNED_BYTE: return sizeof(GLubyte);
+		case GL_UNSIGNED_SHORT: return sizeof(GLushort);
+		default: return sizeof(GLuint);
+		}
+	}
+
+	const void* narrowIndices(const GLuint* indices, size_t indexCount, GLenum type,
+		std::vector<unsigned char>& storage)
+	{
+		if (type == GL_UNSIGNED_INT || indices == NULL)
+		{
+			return indices;
+		}
+		storage.resize(indexCount * indexSize(type));
+		if (type == GL_UNSIGNED_BYTE)
+		{
+			for (size_t i = 0; i < indexCount; i++)
+			{
+				storage[i] = (GLubyte)indices[i];
+			}
+		}
+		else
+		{
+			GLushort* narrow = (GLushort*)storage.data();
+			for (size_t i = 0; i < indexCount; i++)
+			{
+				narrow[i] = (GLushort)indices[i];
+			}
+		}
+		return storage.data();
+	}
+
+	void setDequantization(shaders::Shader& shader, const glm::vec3& positionScale,
+		const glm::vec3& positionOffset, bool octahedralNormals)
+	{
+		shader.set(shaders::Uniform::PositionScale, positionScale);
+		shader.set(shaders::Uniform::PositionOffset, positionOffset);
+		shader.set(shaders::Uniform::OctahedralNormals, (GLint)octahedralNormals);
+	}
+
+	void instanceAttributes()
+	{
+		for (GLuint column = 0; column < 4; column++)
+		{
+			glEnableVertexAttribArray(INSTANCE_LOCATION + column);
+			glVertexAttribDivisor(INSTANCE_LOCATION + column, 1);
+		}
+	}
+
+	// InstanceBuffer class
+	void InstanceBuffer::update(const glm::mat4* transforms, GLsizei uCount)
+	{
+		if (ID == 0)
+		{
+			glGenBuffers(1, &ID);
+		}
+		// Respecifying the whole buffer lets the driver hand out new storage
+		// instead of waiting for draws still reading the old matrices
+		glBindBuffer(GL_ARRAY_BUFFER, ID);
+		glBufferData(GL_ARRAY_BUFFER, uCount * sizeof(glm::mat4), transforms, GL_DYNAMIC_DRAW);
+		if (uCount != count)
+		{
+			gpumem::trackBuffer(ID, gpumem::Kind::Vertex, uCount * sizeof(glm::mat4));
+		}
+		count = uCount;
+	}
+
+	void InstanceBuffer::release()
+	{
+		if (ID == 0)
+		{
+			return;
+		}
+		glDeleteBuffers(1, &ID);
+		glstate::deletedBuffer(ID);
+		gpumem::release(ID, gpumem::Kind::Vertex);
+		ID = 0;
+		count = 0;
+	}
+
 	// Constructor vertex vectors
 	TriangleMesh::TriangleMesh(std::vector<Vertex> uVertices,
-		std::vector<GLushort> uIndices,
+		std::vector<GLuint> uIndices,
 		shaders::Shader uShader,
 		std::string image,
 		glm::vec4 uSpecular,
@@ -36,7 +193,7 @@ namespace mesh
 
 	// Constructor with vector of floats
 	TriangleMesh::TriangleMesh(std::vector<GLfloat> uVertices, 
-		std::vector<GLushort> uIndices,
+		std::vector<GLuint> uIndices,
 		shaders::Shader uShader,
 		std::string image,
 		glm::vec4 uSpecular,
@@ -77,10 +234,22 @@ namespace mesh
 	// Copy constructor
 	TriangleMesh::TriangleMesh(const TriangleMesh &original)
 	{
-		vertices = original.vertices;
-		indices = original.indices;
-		model = glm::mat4(1.0f);
-		createMesh();
+		copyMesh(original);
+	}
+
+	TriangleMesh& TriangleMesh::operator=(const TriangleMesh &original)
+	{
+		if (this != &original)
+		{
+			destroyMesh();
+			copyMesh(original);
+		}
+		return *this;
+	}
+
+	TriangleMesh::~TriangleMesh()
+	{
+		destroyMesh();
 	}
 
 	void TriangleMesh::rotate(GLfloat degrees, GLchar axis)
@@ -121,150 +290,248 @@ namespace mesh
 
 	void TriangleMesh::draw()
 	{
+		glstats::ScopedCaller caller{ "TriangleMesh::draw" };
 		shaderProgram.use();
 
 		// Sets material settings in shader
-		
-		// Sets the diffuse map
-		GLuint materialDiffuseLoc = glGetUniformLocation(shaderProgram.ID, "material.diffuse");
-		glUniform1i(materialDiffuseLoc, texture);
+		shaderProgram.set(shaders::Uniform::TextureLayer, texture.layer);
+		shaderProgram.set(shaders::Uniform::MaterialSpecular, specular);
+		shaderProgram.set(shaders::Uniform::MaterialShininess, shininess);
 
-		GLuint materialSpecularLoc = glGetUniformLocation(shaderProgram.ID, "material.specular");
-		glUniform4fv(materialSpecularLoc, 1, glm::value_ptr(specular));
-
-		GLuint materialShininessLoc = glGetUniformLocation(shaderProgram.ID, "material.shininess");
-		glUniform1f(materialShininessLoc, shininess);
-
-		// Sets model in shader
-		GLuint modelLoc = glGetUniformLocation(shaderProgram.ID, "model");
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		// Uploads the model matrix as the one instance
+		if (instances.count == 0 || model != uploadedModel)
+		{
+			gpumem::ScopedOwner owner{ "TriangleMesh " + imagePath };
+			instances.update(&model, 1);
+			uploadedModel = model;
+		}
+		setDequantization(shaderProgram, glm::vec3(1.0f), glm::vec3(0.0f), false);
 
-		// Binds texture and vertex array
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glBindVertexArray(VAO);
+		// Binds texture and vertex array, both are shared with other meshes
+		// so they stay bound for them
+		texturearrays::bind(texture.array);
+		glstate::bindVertexArray(allocation->VAO);
+		glstate::instanceBuffer(INSTANCE_LOCATION, instances.ID);
 
 		// Draws elements
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_SHORT, 0);  // Draw EBO
-		glBindVertexArray(0);
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indices.size(), indexType,
+			(void*)allocation->indexOffset, 1, allocation->baseVertex);
 	}
 
-	void TriangleMesh::createMesh()
+	void TriangleMesh::copyMesh(const TriangleMesh &original)
 	{
-		// Generates vertex buffer objects, vertex array objects, and texture object
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
-		glGenTextures(1, &texture);
-
-		// Binds the VAO which will contain buffers and vertex attributes
-		glBindVertexArray(VAO);
-
-		// Binds VBO to GL_ARRAY_BUFFER target and adds vertices data
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-		// Binds EBO to GL_ELEMENT_ARRAY_BUFFER target and adds indicies data
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
-
-		// Binds texture
-		glBindTexture(GL_TEXTURE_2D, texture);
-		// Sets texture wrapping and filtering options
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		// Load and generate texture
-		GLint T_width, T_height, T_nrChannels;
-		unsigned char* imageData = stbi_load(imagePath.c_str(), &T_width, &T_height, &T_nrChannels, 0);
-		// Loads texture image
-		if (imageData)
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, T_width, T_height, 0, GL_RGB, GL_UNSIGNED_BYTE, imageData);
-			glGenerateMipmap(GL_TEXTURE_2D);
-		}
-		else
-		{
-			std::cout << "ERROR: Failed to load texture" << std::endl;
-		}
-		stbi_image_free(imageData); // Frees image memory
-
-		// Vertex postion
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-		glEnableVertexAttribArray(0);
+		// Settings are copied, the buffers, instance buffer and texture
+		// reference are the copy's own so either mesh can go away first
+		shaderProgram = original.shaderProgram;
+		imagePath = original.imagePath;
+		vertices = original.vertices;
+		indices = original.indices;
+		model = original.model;
+		diffuse = original.diffuse;
+		specular = original.specular;
+		shininess = original.shininess;
+		createMesh();
+	}
 
-		// Vertex normals
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-		glEnableVertexAttribArray(1);
+	void TriangleMesh::destroyMesh()
+	{
+		bufferheap::free(allocation);
+		allocation = NULL;
+		instances.release();
+		textures::cache().release(texture);
+		texture = textures::Layer();
+	}
 
-		// Texture coordinates
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texture));
-		glEnableVertexAttribArray(2);
+	void TriangleMesh::createMesh()
+	{
+		glstats::ScopedCaller caller{ "TriangleMesh::createMesh" };
+		gpumem::ScopedOwner owner{ "TriangleMesh " + imagePath };
+		// Reorders triangles and vertices for the GPU caches before upload
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		meshopt::CacheStats before, after;
+		meshopt::optimizeMesh(vertices, indices, before, after);
+		std::cout << "Optimized TriangleMesh " << imagePath << " (" << profiler::elapsedMs(start) << " ms): "
+			<< "ACMR " << before.acmr() << " -> " << after.acmr()
+			<< ", ATVR " << before.atvr() << " -> " << after.atvr() << std::endl;
+
+		// Sub-allocates from the buffer heap and adds the vertices and the
+		// indices, in the narrowest type that fits
+		indexType = mesh::indexType(vertices.size());
+		std::vector<unsigned char> narrowed;
+		const void* indexData = narrowIndices(indices.data(), indices.size(), indexType, narrowed);
+		allocation = allocate(VertexFormat::Float, vertices.size(), indices.size() * indexSize(indexType));
+		upload(allocation, sizeof(Vertex), vertices.data(), indexData, indices.size() * indexSize(indexType));
+
+		// Loads texture image, shared with every other mesh that uses the same file
+		texture = textures::cache().acquire(imagePath);
 	}
 
 	// Mesh class constructor
-	Mesh::Mesh(std::vector<Vertex> uVertices, std::vector<GLuint> uIndices, std::vector<Texture> uTextures)
+	Mesh::Mesh(std::vector<Vertex> uVertices, std::vector<GLuint> uIndices, std::vector<Texture> uTextures,
+		VertexFormat uFormat)
 	{
+		format = uFormat;
 		vertices = uVertices;
 		indices = uIndices;
 		textures = uTextures;
-		setup();
+		setup(vertices.data(), vertices.size(), indices.data(), indices.size());
+	}
+
+	Mesh::Mesh(const Vertex* uVertices, size_t uVertexCount, const GLuint* uIndices, size_t uIndexCount, std::vector<Texture> uTextures,
+		VertexFormat uFormat)
+	{
+		format = uFormat;
+		textures = uTextures;
+		setup(uVertices, uVertexCount, uIndices, uIndexCount);
+	}
+
+	Vertex* Mesh::mapVertices()
+	{
+		return (Vertex*)mapRange(VertexFormat::Float, sizeof(Vertex));
+	}
+
+	PackedVertex* Mesh::mapPackedVertices(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		positionScale = boundsMax - boundsMin;
+		positionOffset = boundsMin;
+		return (PackedVertex*)mapRange(VertexFormat::Packed, sizeof(PackedVertex));
 	}
 
-	void Mesh::setup()
+	void* Mesh::mapRange(VertexFormat expected, size_t vertexSize)
 	{
-		// Generates vertex buffer objects, vertex array objects, and texture object
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
+		// Invalidating tells the driver the old contents are not needed
+		if (vertexCount == 0 || allocation == NULL)
+		{
+			return NULL;
+		}
+		if (format != expected)
+		{
+			std::cout << "ERROR: mesh vertices were mapped in the wrong format" << std::endl;
+			return NULL;
+		}
+		// Only this mesh's range may be invalidated, the rest of the buffer belongs to other meshes
+		glBindBuffer(GL_ARRAY_BUFFER, allocation->VBO);
+		void* data = glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)allocation->baseVertex * vertexSize,
+			vertexCount * vertexSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		verticesMapped = data != NULL;
+		return data;
+	}
 
-		glBindVertexArray(VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	bool Mesh::unmap()
+	{
+		// Unmapping fails if the buffer contents were lost while mapped
+		bool intact = true;
+		if (verticesMapped)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, allocation->VBO);
+			intact = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+			verticesMapped = false;
+		}
 
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+		if (!intact)
+		{
+			std::cout << "ERROR: mesh buffer contents were lost while mapped" << std::endl;
+		}
+		return intact;
+	}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+	void Mesh::setup(const Vertex* vertexData, size_t uVertexCount, const GLuint* indexData, size_t count)
+	{
+		vertexCount = (GLsizei)uVertexCount;
+		indexCount = (GLsizei)count;
+		Lod full;
+		full.firstIndex = 0;
+		full.indexCount = indexCount;
+		full.error = 0.0f;
+		lods.assign(1, full);
+		lodInstances.clear();
+		lod = 0;
+		verticesMapped = false;
+		indexType = mesh::indexType(uVertexCount);
+		positionScale = glm::vec3(1.0f);
+		positionOffset = glm::vec3(0.0f);
+		glstats::ScopedCaller caller{ "Mesh::setup" };
+
+		// Packs a temporary copy, the buffer is all the mesh keeps of it
+		std::vector<PackedVertex> packed;
+		const void* uploadData = vertexData;
+		size_t vertexSize = sizeof(Vertex);
+		if (format == VertexFormat::Packed)
+		{
+			vertexSize = sizeof(PackedVertex);
+			if (vertexData)
+			{
+				packed.resize(uVertexCount);
+				quantize::packVertices(vertexData, uVertexCount, packed.data(), positionScale, positionOffset);
+				uploadData = packed.data();
+			}
+		}
 
-		// vertex positions
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-		// vertex normals
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-		// vertex texture coords
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texture));
+		// Sub-allocates from the buffer heap block of this format
+		std::vector<unsigned char> narrowed;
+		allocation = allocate(format, uVertexCount, count * indexSize(indexType));
+		upload(allocation, (GLsizei)vertexSize, uploadData,
+			narrowIndices(indexData, count, indexType, narrowed), count * indexSize(indexType));
+	}
 
-		glBindVertexArray(0);
+	void Mesh::release()
+	{
+		bufferheap::free(allocation);
+		allocation = NULL;
 	}
 
-	void Mesh::draw(shaders::Shader& shader)
+	void Mesh::draw(shaders::Shader& shader, const InstanceBuffer& instances)
 	{
+		glstats::ScopedCaller caller{ "Mesh::draw" };
 		shader.use();
-		GLuint diffuseNr = 1;
-		GLuint specularNr = 1;
-		for (size_t i = 0; i < textures.size(); i++)
+		issue(shader, instances);
+	}
+
+	size_t Mesh::issue(shaders::Shader& shader, const InstanceBuffer& instances)
+	{
+		glstats::ScopedCaller caller{ "Mesh::issue" };
+		// The shader samples one texture, the first, from the array on unit 0.
+		// Meshes whose textures share an array don't bind anything.
+		if (!textures.empty())
+		{
+			texturearrays::bind(textures[0].array);
+			shader.set(shaders::Uniform::TextureLayer, textures[0].layer);
+		}
+		setDequantization(shader, positionScale, positionOffset, format == VertexFormat::Packed);
+
+		// draw mesh, the VAO is shared with the other meshes in the heap block so it stays bound
+		if (allocation == NULL || instances.count == 0)
+		{
+			return 0;
+		}
+		glstate::bindVertexArray(allocation->VAO);
+		if (lodInstances.empty())
+		{
+			glstate::instanceBuffer(INSTANCE_LOCATION, instances.ID);
+			drawLevel(lod, instances.count);
+			return 1;
+		}
+
+		// Each level draws its range of the instance buffer
+		size_t drawn = 0;
+		for (size_t level = 0; level < lodInstances.size() && level < lods.size(); level++)
 		{
-			// Activates the texture 
-			glActiveTexture(GL_TEXTURE0 + i);
-			// retrieve texture number (the N in diffuse_textureN)
-			std::string number;
-			std::string name = textures[i].type;
-			if (name == "texture_diffuse")
-				number = std::to_string(diffuseNr++);
-			else if (name == "texture_specular")
-				number = std::to_string(specularNr++);
-
-			// Sets uniform variable in shader
-			glUniform1f(glGetUniformLocation(shader.ID, ("material." + name + number).c_str()), i);
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+			const InstanceRange& range = lodInstances.at(level);
+			if (range.count == 0 || range.first + range.count > instances.count)
+			{
+				continue;
+			}
+			glstate::instanceBuffer(INSTANCE_LOCATION, instances.ID, range.first);
+			drawLevel(level, range.count);
+			drawn++;
 		}
-		glActiveTexture(GL_TEXTURE0);
+		return drawn;
+	}
 
-		// draw mesh
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+	void Mesh::drawLevel(size_t level, GLsizei instanceCount)
+	{
+		const Lod& range = lods.at(level);
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, indexType,
+			(void*)(allocation->indexOffset + range.firstIndex * indexSize(indexType)), instanceCount, allocation->baseVertex);
 	}
 }
\ No newline at end of file
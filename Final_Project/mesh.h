@@ -20,6 +20,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "shaders.h"
+#include "bufferheap.h"
+#include "glstate.h"
+#include "glstats.h"
+#include "gpumem.h"
+#include "textures.h"
 #include "stb_image.h"
 
 namespace mesh
@@ -40,44 +45,121 @@ namespace mesh
 			position{ p }, normal{ n }, texture{ t } {}
 	};
 
+	// Half size vertex. Positions are 16 bit fractions of the mesh's bounding
+	// box, normals are octahedral encoded into two 16 bit values and texture
+	// coordinates are half floats. The vertex shaders decode all three.
+	struct PackedVertex
+	{
+		GLushort position[4]; // the fourth value pads to 8 bytes
+		GLshort normal[2];
+		GLushort texture[2];
+	};
+
+	// Vertex layout a Mesh uploads, the CPU side always uses Vertex
+	enum class VertexFormat
+	{
+		Float,  // Vertex, 32 bytes
+		Packed  // PackedVertex, 16 bytes
+	};
+
+	// Narrowest index type that can address vertexCount vertices:
+	// GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	GLenum indexType(size_t vertexCount);
+	size_t indexSize(GLenum type);
+	// Converts indices to type for upload. Returns indices itself for
+	// GL_UNSIGNED_INT, otherwise storage, which holds the narrowed copy.
+	const void* narrowIndices(const GLuint* indices, size_t indexCount, GLenum type,
+		std::vector<unsigned char>& storage);
+
+	// Tells the vertex shader how to decode the bound vertices. Meshes set it
+	// before drawing, float vertices use a scale of one and an offset of zero.
+	void setDequantization(shaders::Shader& shader, const glm::vec3& positionScale,
+		const glm::vec3& positionOffset, bool octahedralNormals);
+
+	// First of the four attribute locations holding the model matrix, one
+	// column each. The attribute advances once per instance, not per vertex.
+	const GLuint INSTANCE_LOCATION = 3;
+	// Enables the model matrix attributes of the bound VAO
+	void instanceAttributes();
+
+	// Model matrices of every copy of a mesh, drawn by instanced draws
+	class InstanceBuffer
+	{
+	public:
+		GLuint ID;
+		GLsizei count;
+		InstanceBuffer() : ID{ 0 }, count{ 0 } {}
+		// Replaces the matrices, creating the buffer on first use
+		void update(const glm::mat4* transforms, GLsizei uCount);
+		void release();
+	};
+
+	// Matrices first to first + count - 1 of an instance buffer
+	struct InstanceRange
+	{
+		GLsizei first;
+		GLsizei count;
+	};
+
+	// A layer of a texture array, see texturearrays
 	struct Texture {
-		GLuint id;
+		GLuint array; // 0 until the image is uploaded
+		GLint layer;
 		std::string type;
 		std::string path;
-		Texture() : id{ 0 }, type{ "" }, path{ "" } {}
+		Texture() : array{ 0 }, layer{ 0 }, type{ "" }, path{ "" } {}
+	};
+
+	// One level of detail, a range of a mesh's index buffer
+	struct Lod
+	{
+		GLuint firstIndex;
+		GLsizei indexCount;
+		float error; // largest distance from the full detail surface, in model units
 	};
 
 	class TriangleMesh
 	{
 	public:
 		std::vector<Vertex> vertices;
-		std::vector<GLushort> indices;
+		std::vector<GLuint> indices;
 		glm::mat4 model;
+		// Holds model, uploaded again when it changes
+		InstanceBuffer instances;
 		shaders::Shader shaderProgram;
-		GLuint VAO, VBO, EBO, texture;
+		textures::Layer texture;
+		bufferheap::Allocation* allocation;
+		GLenum indexType; // picked from the vertex count when uploading
 		glm::vec4 diffuse, specular;
 		GLfloat shininess;
 		std::string imagePath;
 		TriangleMesh(std::vector<Vertex> uVertices, 
-			std::vector<GLushort> uIndices,
+			std::vector<GLuint> uIndices,
 			shaders::Shader uShader,
 			std::string image,
 			glm::vec4 uSpecular,
 			GLfloat uShininess);
 		TriangleMesh(std::vector<GLfloat> uVertices,
-			std::vector<GLushort> uIndices,
+			std::vector<GLuint> uIndices,
 			shaders::Shader uShader,
 			std::string image,
 			glm::vec4 uSpecular,
 			GLfloat uShininess);
+		// Copies upload their own buffers and take their own texture reference
 		TriangleMesh(const TriangleMesh &original);
+		TriangleMesh& operator=(const TriangleMesh &original);
+		// Frees the buffer range, the instance buffer and the texture reference
+		~TriangleMesh();
 		void draw();
 		void rotate(GLfloat degrees, GLchar axis);
 		void scale(GLfloat x, GLfloat y, GLfloat z);
 		void translate(GLfloat x, GLfloat y, GLfloat z);
 		
 	private:
+		glm::mat4 uploadedModel;
+		void copyMesh(const TriangleMesh &original);
 		void createMesh();
+		void destroyMesh();
 	};
 
 	class Mesh
@@ -86,12 +168,48 @@ namespace mesh
 		std::vector<Vertex> vertices;
 		std::vector<GLuint> indices;
 		std::vector<Texture> textures;
+		GLsizei vertexCount, indexCount;
+		// Levels of detail, the first is the full mesh
+		std::vector<Lod> lods;
+		// Instances drawn at each level, one range of the instance buffer per
+		// level. Without ranges every instance draws at lod.
+		std::vector<InstanceRange> lodInstances;
+		size_t lod;
+		// Packed meshes decode positions as packed * positionScale + positionOffset
+		VertexFormat format;
+		glm::vec3 positionScale, positionOffset;
+		// The index buffer holds indices of this type, see mesh::indexType
+		GLenum indexType;
 
-		Mesh(std::vector<Vertex> uVertices, std::vector<GLuint> uIndices, std::vector<Texture> uTextures);
-		void draw(shaders::Shader& shader);
+		Mesh(std::vector<Vertex> uVertices, std::vector<GLuint> uIndices, std::vector<Texture> uTextures,
+			VertexFormat uFormat = VertexFormat::Float);
+		// Uploads from memory the mesh does not keep a copy of, e.g. a mapped mesh cache.
+		// Null vertices only allocate the buffer, which is then filled through mapVertices.
+		Mesh(const Vertex* uVertices, size_t uVertexCount, const GLuint* uIndices, size_t uIndexCount, std::vector<Texture> uTextures,
+			VertexFormat uFormat = VertexFormat::Float);
+		// Maps the vertex buffer write-only so it can be filled in place. Write
+		// each element once and in order, the memory may be uncached.
+		Vertex* mapVertices();
+		// Same for packed meshes. Packing needs the whole mesh's bounds, so the
+		// caller passes them in and packs with positionScale and positionOffset.
+		PackedVertex* mapPackedVertices(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+		bool unmap();
+		// Draws a copy for every matrix in instances
+		void draw(shaders::Shader& shader, const InstanceBuffer& instances);
+		// Draws like draw, for callers that already made shader current.
+		// Returns the number of draw calls, one per level with instances.
+		size_t issue(shaders::Shader& shader, const InstanceBuffer& instances);
+		// The heap block's VAO, 0 before upload
+		GLuint vertexArray() const { return allocation == NULL ? 0 : allocation->VAO; }
+		// Returns the mesh's buffer ranges to the heap. Copies of a mesh share
+		// its ranges, so only one of them may release.
+		void release();
 
 	private:
-		GLuint VAO, VBO, EBO;
-		void setup();
+		bufferheap::Allocation* allocation;
+		bool verticesMapped;
+		void drawLevel(size_t level, GLsizei instanceCount);
+		void* mapRange(VertexFormat expected, size_t vertexSize);
+		void setup(const Vertex* vertexData, size_t uVertexCount, const GLuint* indexData, size_t count);
 	};
 }
@@ -0,0 +1,445 @@
+/*
+* meshcache.cpp
+* This file contains implementations for the binary mesh cache
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "meshcache.h"
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace meshcache
+{
+	// Vertices are stored exactly as they are uploaded
+	static_assert(sizeof(mesh::Vertex) == 8 * sizeof(float), "mesh::Vertex must be tightly packed");
+
+	const char MAGIC[4] = { 'M', 'S', 'H', 'C' };
+
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint32_t meshCount;
+		uint32_t reserved;
+	};
+
+	// Helper functions
+
+	// Loaders importing the same model at once, in this process or another,
+	// stream into separate files and the last one moved into place is kept
+	std::string temporaryPath(const std::string& path)
+	{
+		static std::atomic<unsigned int> opened{ 0 };
+		std::ostringstream name;
+#ifdef _WIN32
+		name << path << "." << GetCurrentProcessId() << "." << opened++ << ".tmp";
+#else
+		name << path << "." << getpid() << "." << opened++ << ".tmp";
+#endif
+		return name.str();
+	}
+
+	// Rounds up so arrays in the file stay 4 byte aligned
+	size_t align4(size_t offset)
+	{
+		return (offset + 3) & ~(size_t)3;
+	}
+
+	// Reads a value and advances the offset, fails past the end of the file
+	template <class T>
+	bool readValue(const MappedFile& file, size_t& offset, T& value)
+	{
+		if (offset + sizeof(T) > file.size)
+		{
+			return false;
+		}
+		std::memcpy(&value, file.data + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	bool readString(const MappedFile& file, size_t& offset, std::string& value)
+	{
+		uint32_t length = 0;
+		if (!readValue(file, offset, length) || offset + length > file.size)
+		{
+			return false;
+		}
+		value.assign((const char*)file.data + offset, length);
+		offset += length;
+		return true;
+	}
+
+	template <class T>
+	void writeValue(std::ofstream& out, const T& value)
+	{
+		out.write((const char*)&value, sizeof(T));
+	}
+
+	void writeString(std::ofstream& out, const std::string& value)
+	{
+		writeValue(out, (uint32_t)value.size());
+		out.write(value.data(), value.size());
+	}
+
+	void writePadding(std::ofstream& out)
+	{
+		const char zeros[4] = { 0, 0, 0, 0 };
+		size_t position = (size_t)out.tellp();
+		out.write(zeros, align4(position) - position);
+	}
+
+	// MappedFile class
+	MappedFile::MappedFile() : data{ NULL }, size{ 0 }, fileHandle{ NULL }, mappingHandle{ NULL } {}
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data == NULL)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+		size = (size_t)fileSize.QuadPart;
+		fileHandle = file;
+		mappingHandle = mapping;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (data)
+		{
+			UnmapViewOfFile(data);
+			CloseHandle((HANDLE)mappingHandle);
+			CloseHandle((HANDLE)fileHandle);
+		}
+		data = NULL;
+		size = 0;
+		fileHandle = NULL;
+		mappingHandle = NULL;
+	}
+#else
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			::close(fd);
+			return false;
+		}
+		void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd); // the mapping keeps the file alive
+		if (mapped == MAP_FAILED)
+		{
+			return false;
+		}
+		data = (const unsigned char*)mapped;
+		size = (size_t)info.st_size;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (data)
+		{
+			munmap((void*)data, size);
+		}
+		data = NULL;
+		size = 0;
+	}
+#endif
+
+	uint64_t combine(uint64_t key, uint64_t value)
+	{
+		for (size_t i = 0; i < sizeof(value); i++)
+		{
+			key ^= (value >> (i * 8)) & 0xff;
+			key *= 1099511628211ULL;
+		}
+		return key;
+	}
+
+	uint64_t hash(const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		uint64_t hash = 14695981039346656037ULL;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	uint64_t hashFile(const std::string& path)
+	{
+		MappedFile file;
+		if (!file.open(path))
+		{
+			return 0;
+		}
+		return hash(file.data, file.size);
+	}
+
+	uint64_t hashSource(const std::string& path)
+	{
+		MappedFile file;
+		if (!file.open(path))
+		{
+			return 0;
+		}
+		uint64_t key = hash(file.data, file.size);
+
+		std::string extension = path.substr(path.find_last_of('.') + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if (extension != "obj")
+		{
+			return key;
+		}
+
+		// Materials are read from the libraries on mtllib lines, relative to the
+		// model. A missing library hashes to 0, so creating it changes the key.
+		size_t slash = path.find_last_of("/\\");
+		std::string directory = (slash == std::string::npos) ? "" : path.substr(0, slash + 1);
+		const char* text = (const char*)file.data;
+		size_t start = 0;
+		while (start < file.size)
+		{
+			size_t end = start;
+			while (end < file.size && text[end] != '\n')
+			{
+				end++;
+			}
+			if (end - start > 7 && std::memcmp(text + start, "mtllib", 6) == 0
+				&& (text[start + 6] == ' ' || text[start + 6] == '\t'))
+			{
+				std::istringstream names(std::string(text + start + 7, end - start - 7));
+				std::string name;
+				while (names >> name)
+				{
+					key = combine(key, hashFile(directory + name));
+				}
+			}
+			start = end + 1;
+		}
+		return key;
+	}
+
+	std::string cachePath(const std::string& sourcePath)
+	{
+		return sourcePath + ".meshcache";
+	}
+
+	bool read(const MappedFile& file, uint64_t key, std::vector<MeshView>& meshes)
+	{
+		size_t offset = 0;
+		FileHeader header;
+		if (!readValue(file, offset, header)
+			|| std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+			|| header.version != VERSION
+			|| header.key != key)
+		{
+			return false;
+		}
+
+		meshes.clear();
+		for (uint32_t i = 0; i < header.meshCount; i++)
+		{
+			MeshView view;
+			uint32_t textureCount = 0;
+			uint32_t lodCount = 0;
+			if (!readValue(file, offset, view.vertexCount)
+				|| !readValue(file, offset, view.indexCount)
+				|| !readValue(file, offset, textureCount)
+				|| !readValue(file, offset, lodCount))
+			{
+				return false;
+			}
+
+			for (uint32_t l = 0; l < lodCount; l++)
+			{
+				mesh::Lod lod;
+				if (!readValue(file, offset, lod.firstIndex)
+					|| !readValue(file, offset, lod.indexCount)
+					|| !readValue(file, offset, lod.error)
+					|| (size_t)lod.firstIndex + lod.indexCount > view.indexCount)
+				{
+					return false;
+				}
+				view.lods.push_back(lod);
+			}
+
+			for (uint32_t t = 0; t < textureCount; t++)
+			{
+				TextureRef texture;
+				if (!readString(file, offset, texture.type) || !readString(file, offset, texture.path))
+				{
+					return false;
+				}
+				view.textures.push_back(texture);
+			}
+
+			// Vertex and index arrays are used in place
+			offset = align4(offset);
+			size_t vertexBytes = (size_t)view.vertexCount * sizeof(mesh::Vertex);
+			size_t indexBytes = (size_t)view.indexCount * sizeof(GLuint);
+			if (offset + vertexBytes + indexBytes > file.size)
+			{
+				return false;
+			}
+			view.vertices = (const mesh::Vertex*)(file.data + offset);
+			offset += vertexBytes;
+			view.indices = (const GLuint*)(file.data + offset);
+			offset += indexBytes;
+
+			meshes.push_back(view);
+		}
+		return true;
+	}
+
+	// Writer class
+	Writer::Writer() : meshCount{ 0 } {}
+
+	Writer::~Writer()
+	{
+		if (out.is_open())
+		{
+			out.close();
+			std::remove(temporary.c_str());
+		}
+	}
+
+	bool Writer::open(const std::string& uPath, uint64_t key)
+	{
+		// Writes to a temporary file first so a crash never leaves a half written cache
+		path = uPath;
+		temporary = temporaryPath(path);
+		meshCount = 0;
+		out.open(temporary, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			std::cout << "ERROR: failed to write mesh cache " << path << std::endl;
+			return false;
+		}
+
+		// The mesh count is patched in by close
+		FileHeader header;
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.key = key;
+		header.meshCount = 0;
+		header.reserved = 0;
+		writeValue(out, header);
+		return true;
+	}
+
+	void Writer::add(const mesh::Vertex* vertices, uint32_t vertexCount,
+		const GLuint* indices, uint32_t indexCount,
+		const std::vector<mesh::Texture>& textures,
+		const std::vector<mesh::Lod>& lods)
+	{
+		if (!out.is_open())
+		{
+			return;
+		}
+		writeValue(out, vertexCount);
+		writeValue(out, indexCount);
+		writeValue(out, (uint32_t)textures.size());
+		writeValue(out, (uint32_t)lods.size());
+		for (size_t l = 0; l < lods.size(); l++)
+		{
+			writeValue(out, lods.at(l).firstIndex);
+			writeValue(out, lods.at(l).indexCount);
+			writeValue(out, lods.at(l).error);
+		}
+		for (size_t t = 0; t < textures.size(); t++)
+		{
+			writeString(out, textures.at(t).type);
+			writeString(out, textures.at(t).path);
+		}
+		writePadding(out);
+		out.write((const char*)vertices, (size_t)vertexCount * sizeof(mesh::Vertex));
+		out.write((const char*)indices, (size_t)indexCount * sizeof(GLuint));
+		meshCount++;
+	}
+
+	bool Writer::close()
+	{
+		if (!out.is_open())
+		{
+			return false;
+		}
+		out.seekp(offsetof(FileHeader, meshCount));
+		writeValue(out, meshCount);
+		bool written = (bool)out;
+		out.close();
+
+		if (!written)
+		{
+			std::cout << "ERROR: failed to write mesh cache " << path << std::endl;
+			std::remove(temporary.c_str());
+			return false;
+		}
+		std::remove(path.c_str());
+		return std::rename(temporary.c_str(), path.c_str()) == 0;
+	}
+}
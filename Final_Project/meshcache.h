@@ -0,0 +1,104 @@
+/*
+* meshcache.h
+* This file contains declarations for the binary mesh cache
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "mesh.h"
+
+// After the first import a model's final vertex and index arrays are written
+// next to the source as <file>.meshcache. Later runs map that file and upload
+// straight from it, skipping Assimp. The file is ignored when its version or
+// the key (hash of the source file and import settings) does not match.
+
+namespace meshcache
+{
+	// Bump whenever the layout of the file or of mesh::Vertex changes. Output
+	// changes of meshopt and simplify go in their own VERSION, see the key.
+	const uint32_t VERSION = 2;
+
+	struct TextureRef
+	{
+		std::string type;
+		std::string path; // relative to the model directory
+	};
+
+	// One mesh inside a mapped cache file, the arrays point into the mapping
+	struct MeshView
+	{
+		const mesh::Vertex* vertices;
+		uint32_t vertexCount;
+		const GLuint* indices;
+		uint32_t indexCount;      // every level of detail
+		std::vector<TextureRef> textures;
+		std::vector<mesh::Lod> lods; // empty if none were built
+	};
+
+	// Read-only memory mapping of a whole file
+	class MappedFile
+	{
+	public:
+		const unsigned char* data;
+		size_t size;
+		MappedFile();
+		~MappedFile();
+		bool open(const std::string& path);
+		void close();
+	private:
+		void* fileHandle;
+		void* mappingHandle;
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+	};
+
+	// FNV-1a hash of a block of memory
+	uint64_t hash(const void* data, size_t size);
+	// FNV-1a hash of the bytes of a file, 0 if it cannot be read
+	uint64_t hashFile(const std::string& path);
+	// Hash of a model file combined with the files it pulls in, for now the
+	// material libraries named on an OBJ's mtllib lines. 0 if the model
+	// cannot be read.
+	uint64_t hashSource(const std::string& path);
+	// Mixes extra settings (e.g. import flags) into a key
+	uint64_t combine(uint64_t key, uint64_t value);
+	std::string cachePath(const std::string& sourcePath);
+
+	// Parses a mapped cache file, fails if it is stale or malformed
+	bool read(const MappedFile& file, uint64_t key, std::vector<MeshView>& meshes);
+
+	// Streams meshes into a new cache file one at a time, so a whole
+	// model never has to be held in memory to write it
+	class Writer
+	{
+	public:
+		Writer();
+		~Writer();
+		bool open(const std::string& path, uint64_t key);
+		void add(const mesh::Vertex* vertices, uint32_t vertexCount,
+			const GLuint* indices, uint32_t indexCount,
+			const std::vector<mesh::Texture>& textures,
+			const std::vector<mesh::Lod>& lods);
+		// Finishes the file and moves it into place, nothing is left behind on failure
+		bool close();
+	private:
+		std::ofstream out;
+		std::string path;
+		std::string temporary; // unique to this writer, renamed to path by close
+		uint32_t meshCount;
+		Writer(const Writer&);
+		Writer& operator=(const Writer&);
+	};
+}
@@ -0,0 +1,367 @@
+/*
+* meshopt.cpp
+* This file contains implementations for the mesh optimization pass
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+* Vertex cache ordering follows Sander, Nehab and Barczak,
+* "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007.
+*/
+
+#include "meshopt.h"
+#include <algorithm>
+#include <glm/glm.hpp>
+
+namespace meshopt
+{
+	// Helper functions
+
+	// FIFO cache where a vertex is resident until cacheSize newer vertices entered
+	class CacheSimulator
+	{
+	public:
+		CacheSimulator(size_t vertexCount, size_t uCacheSize) :
+			stamps(vertexCount, 0), time{ uCacheSize + 1 }, cacheSize{ uCacheSize } {}
+		// Returns true if the vertex had to be transformed
+		bool access(GLuint vertex)
+		{
+			if (time - stamps[vertex] > cacheSize)
+			{
+				stamps[vertex] = time++;
+				return true;
+			}
+			return false;
+		}
+		void flush() { time += cacheSize + 1; }
+	private:
+		std::vector<size_t> stamps;
+		size_t time;
+		size_t cacheSize;
+	};
+
+	// Triangles using each vertex, as offsets into one shared list
+	struct Adjacency
+	{
+		std::vector<GLuint> counts, offsets, triangles;
+	};
+
+	void buildAdjacency(Adjacency& adjacency, const GLuint* indices, size_t indexCount, size_t vertexCount)
+	{
+		adjacency.counts.assign(vertexCount, 0);
+		adjacency.offsets.assign(vertexCount, 0);
+		adjacency.triangles.resize(indexCount);
+
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			adjacency.counts[indices[i]]++;
+		}
+		GLuint offset = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] = offset;
+			offset += adjacency.counts[v];
+		}
+
+		std::vector<GLuint> filled(vertexCount, 0);
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			GLuint vertex = indices[i];
+			adjacency.triangles[adjacency.offsets[vertex] + filled[vertex]++] = (GLuint)(i / 3);
+		}
+	}
+
+	// Area weighted centroid and normal of a run of triangles
+	void clusterShape(const GLuint* indices, size_t firstTriangle, size_t endTriangle,
+		const float* positions, size_t stride, glm::vec3& centroid, glm::vec3& normal)
+	{
+		centroid = glm::vec3(0.0f);
+		normal = glm::vec3(0.0f);
+		float totalArea = 0.0f;
+		for (size_t t = firstTriangle; t < endTriangle; t++)
+		{
+			glm::vec3 corners[3];
+			for (size_t c = 0; c < 3; c++)
+			{
+				const float* p = (const float*)((const char*)positions + indices[t * 3 + c] * stride);
+				corners[c] = glm::vec3(p[0], p[1], p[2]);
+			}
+			glm::vec3 cross = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			float area = glm::length(cross);
+			centroid += (corners[0] + corners[1] + corners[2]) * (area / 3.0f);
+			normal += cross;
+			totalArea += area;
+		}
+		if (totalArea > 0.0f)
+		{
+			centroid /= totalArea;
+		}
+		float length = glm::length(normal);
+		if (length > 0.0f)
+		{
+			normal /= length;
+		}
+	}
+
+	// CacheStats
+	void CacheStats::add(const CacheStats& other)
+	{
+		triangles += other.triangles;
+		vertices += other.vertices;
+		misses += other.misses;
+	}
+
+	CacheStats analyzeVertexCache(const GLuint* indices, size_t indexCount, size_t vertexCount, size_t cacheSize)
+	{
+		CacheStats stats;
+		stats.triangles = indexCount / 3;
+
+		CacheSimulator cache{ vertexCount, cacheSize };
+		std::vector<bool> used(vertexCount, false);
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			if (cache.access(indices[i]))
+			{
+				stats.misses++;
+			}
+			if (!used[indices[i]])
+			{
+				used[indices[i]] = true;
+				stats.vertices++;
+			}
+		}
+		return stats;
+	}
+
+	std::vector<size_t> optimizeVertexCache(GLuint* destination, const GLuint* indices, size_t indexCount,
+		size_t vertexCount, size_t cacheSize)
+	{
+		std::vector<size_t> clusters;
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return clusters;
+		}
+
+		Adjacency adjacency;
+		buildAdjacency(adjacency, indices, indexCount, vertexCount);
+
+		// Triangles still to be emitted around each vertex
+		std::vector<GLuint> live = adjacency.counts;
+		std::vector<size_t> stamps(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<GLuint> deadEnds;
+		std::vector<GLuint> candidates;
+
+		size_t time = cacheSize + 1;
+		size_t cursor = 0;
+		size_t written = 0;
+		GLuint fanning = indices[0];
+		clusters.push_back(0);
+
+		while (true)
+		{
+			// Emits every remaining triangle around the current vertex
+			candidates.clear();
+			GLuint first = adjacency.offsets[fanning];
+			for (GLuint a = first; a < first + adjacency.counts[fanning]; a++)
+			{
+				GLuint triangle = adjacency.triangles[a];
+				if (emitted[triangle])
+				{
+					continue;
+				}
+				emitted[triangle] = true;
+				for (size_t c = 0; c < 3; c++)
+				{
+					GLuint vertex = indices[triangle * 3 + c];
+					destination[written++] = vertex;
+					deadEnds.push_back(vertex);
+					candidates.push_back(vertex);
+					live[vertex]--;
+					if (time - stamps[vertex] > cacheSize)
+					{
+						stamps[vertex] = time++;
+					}
+				}
+			}
+
+			// Prefers the candidate that stays in the cache longest while
+			// its remaining triangles are emitted
+			GLuint next = UNUSED;
+			size_t bestPriority = 0;
+			for (size_t i = 0; i < candidates.size(); i++)
+			{
+				GLuint vertex = candidates[i];
+				if (live[vertex] == 0)
+				{
+					continue;
+				}
+				size_t priority = 0;
+				if (time - stamps[vertex] + 2 * live[vertex] <= cacheSize)
+				{
+					priority = time - stamps[vertex];
+				}
+				if (next == UNUSED || priority > bestPriority)
+				{
+					next = vertex;
+					bestPriority = priority;
+				}
+			}
+
+			if (next == UNUSED)
+			{
+				// Dead end: backtracks through recently used vertices, then
+				// falls back to the next vertex in input order
+				while (!deadEnds.empty() && next == UNUSED)
+				{
+					if (live[deadEnds.back()] > 0)
+					{
+						next = deadEnds.back();
+					}
+					deadEnds.pop_back();
+				}
+				while (cursor < vertexCount && next == UNUSED)
+				{
+					if (live[cursor] > 0)
+					{
+						next = (GLuint)cursor;
+					}
+					cursor++;
+				}
+				if (next == UNUSED)
+				{
+					break;
+				}
+				if (written / 3 < triangleCount)
+				{
+					clusters.push_back(written / 3);
+				}
+			}
+			fanning = next;
+		}
+		return clusters;
+	}
+
+	void optimizeOverdraw(GLuint* indices, size_t indexCount, const float* positions, size_t stride,
+		const std::vector<size_t>& clusters, size_t cacheSize)
+	{
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0 || clusters.empty())
+		{
+			return;
+		}
+
+		size_t vertexCount = 0;
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			vertexCount = std::max(vertexCount, (size_t)indices[i] + 1);
+		}
+
+		// Soft boundaries: inside each cluster, splits wherever the cache
+		// has done about as well as the cluster does on average
+		std::vector<size_t> boundaries;
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			size_t start = clusters[c];
+			size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+			CacheStats whole = analyzeVertexCache(indices + start * 3, (end - start) * 3, vertexCount, cacheSize);
+			double limit = whole.acmr() * OVERDRAW_THRESHOLD;
+
+			CacheSimulator cache{ vertexCount, cacheSize };
+			size_t misses = 0;
+			size_t runStart = start;
+			boundaries.push_back(start);
+			for (size_t t = start; t < end; t++)
+			{
+				for (size_t i = 0; i < 3; i++)
+				{
+					if (cache.access(indices[t * 3 + i]))
+					{
+						misses++;
+					}
+				}
+				size_t runLength = t + 1 - runStart;
+				if (t + 1 < end && (double)misses / runLength <= limit)
+				{
+					boundaries.push_back(t + 1);
+					runStart = t + 1;
+					misses = 0;
+					cache.flush();
+				}
+			}
+		}
+
+		// Orders clusters by how far they face away from the mesh center
+		glm::vec3 meshCentroid, meshNormal;
+		clusterShape(indices, 0, triangleCount, positions, stride, meshCentroid, meshNormal);
+
+		std::vector<std::pair<float, size_t>> order;
+		for (size_t b = 0; b < boundaries.size(); b++)
+		{
+			size_t end = (b + 1 < boundaries.size()) ? boundaries[b + 1] : triangleCount;
+			glm::vec3 centroid, normal;
+			clusterShape(indices, boundaries[b], end, positions, stride, centroid, normal);
+			order.push_back(std::make_pair(-glm::dot(centroid - meshCentroid, normal), b));
+		}
+		std::stable_sort(order.begin(), order.end());
+
+		std::vector<GLuint> original(indices, indices + indexCount);
+		size_t written = 0;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			size_t b = order[i].second;
+			size_t end = (b + 1 < boundaries.size()) ? boundaries[b + 1] : triangleCount;
+			for (size_t t = boundaries[b]; t < end; t++)
+			{
+				indices[written++] = original[t * 3];
+				indices[written++] = original[t * 3 + 1];
+				indices[written++] = original[t * 3 + 2];
+			}
+		}
+	}
+
+	size_t optimizeVertexFetch(std::vector<GLuint>& remap, GLuint* indices, size_t indexCount, size_t vertexCount)
+	{
+		remap.assign(vertexCount, UNUSED);
+		GLuint next = 0;
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			if (remap[indices[i]] == UNUSED)
+			{
+				remap[indices[i]] = next++;
+			}
+			indices[i] = remap[indices[i]];
+		}
+		return next;
+	}
+
+	void optimizeMesh(std::vector<mesh::Vertex>& vertices, std::vector<GLuint>& indices,
+		CacheStats& before, CacheStats& after)
+	{
+		before = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+		if (indices.size() < 3 || indices.size() % 3 != 0)
+		{
+			after = before;
+			return;
+		}
+
+		std::vector<GLuint> ordered(indices.size());
+		std::vector<size_t> clusters = optimizeVertexCache(ordered.data(), indices.data(), indices.size(), vertices.size());
+		optimizeOverdraw(ordered.data(), ordered.size(), &vertices[0].position.x, sizeof(mesh::Vertex), clusters);
+
+		std::vector<GLuint> remap;
+		size_t used = optimizeVertexFetch(remap, ordered.data(), ordered.size(), vertices.size());
+		remapVertices(vertices.data(), vertices.size(), remap);
+		vertices.resize(used);
+		indices.swap(ordered);
+
+		after = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	}
+}
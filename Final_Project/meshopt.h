@@ -0,0 +1,89 @@
+/*
+* meshopt.h
+* This file contains declarations for the mesh optimization pass
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+* Vertex cache ordering follows Sander, Nehab and Barczak,
+* "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include "mesh.h"
+
+// Reorders triangle lists so the GPU shades fewer vertices and fragments:
+// triangles are ordered for the post-transform vertex cache (Tipsify),
+// the resulting clusters are ordered so outward facing ones draw first,
+// and vertices are renumbered in the order the triangles first use them.
+// Every function works on indexed triangle lists.
+
+namespace meshopt
+{
+	// Part of the mesh cache key, changing the orderings' output must change it
+	const std::string VERSION = "tipsify 1";
+	// Post-transform cache size the orderings and statistics assume
+	const size_t CACHE_SIZE = 16;
+	// How much worse than its cluster's average ACMR a split may make the
+	// cache, splits give the overdraw ordering more freedom
+	const double OVERDRAW_THRESHOLD = 1.05;
+	const GLuint UNUSED = 0xffffffff;
+
+	// Simulated FIFO cache results. ACMR is vertex shader runs per triangle
+	// (0.5 is ideal for regular grids, 3 is the worst). ATVR is shader runs
+	// per vertex (1 is ideal).
+	struct CacheStats
+	{
+		size_t triangles, vertices, misses;
+		CacheStats() : triangles{ 0 }, vertices{ 0 }, misses{ 0 } {}
+		double acmr() const { return triangles ? (double)misses / triangles : 0.0; }
+		double atvr() const { return vertices ? (double)misses / vertices : 0.0; }
+		void add(const CacheStats& other);
+	};
+
+	CacheStats analyzeVertexCache(const GLuint* indices, size_t indexCount, size_t vertexCount,
+		size_t cacheSize = CACHE_SIZE);
+
+	// Tipsify. Writes the reordered triangles to destination, which must not
+	// alias indices, and returns the first triangle of every cluster that
+	// starts after the cache was effectively flushed.
+	std::vector<size_t> optimizeVertexCache(GLuint* destination, const GLuint* indices, size_t indexCount,
+		size_t vertexCount, size_t cacheSize = CACHE_SIZE);
+
+	// Splits the clusters further where it costs little cache efficiency, then
+	// orders them so clusters facing away from the mesh center draw first.
+	// positions points at the first vertex position, stride is in bytes.
+	void optimizeOverdraw(GLuint* indices, size_t indexCount, const float* positions, size_t stride,
+		const std::vector<size_t>& clusters, size_t cacheSize = CACHE_SIZE);
+
+	// Renumbers vertices in first use order and rewrites the indices.
+	// remap[old] is the new position, or UNUSED. Returns the used vertex count.
+	size_t optimizeVertexFetch(std::vector<GLuint>& remap, GLuint* indices, size_t indexCount, size_t vertexCount);
+
+	// Moves the vertices of one attribute array to the positions in remap
+	template <class T>
+	void remapVertices(T* vertices, size_t vertexCount, const std::vector<GLuint>& remap)
+	{
+		std::vector<T> original(vertices, vertices + vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			if (remap[i] != UNUSED)
+			{
+				vertices[remap[i]] = original[i];
+			}
+		}
+	}
+
+	// Runs every pass on a mesh's CPU arrays before upload, returns the cache
+	// statistics from before and after. Vertices no triangle uses are dropped.
+	void optimizeMesh(std::vector<mesh::Vertex>& vertices, std::vector<GLuint>& indices,
+		CacheStats& before, CacheStats& after);
+}
@@ -0,0 +1,177 @@
+/*
+* mipmaps.cpp
+* This file contains implementations for generating mip chains on the CPU
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "mipmaps.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include "workers.h"
+
+// Every x64 compiler has SSE2
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIPMAPS_SSE2
+#endif
+
+namespace mipmaps
+{
+	// Linear values are rounded to this many steps to look up their sRGB byte,
+	// fine enough that every byte stays reachable
+	const int LINEAR_STEPS = 4096;
+
+	struct Tables
+	{
+		float toLinear[256];
+		unsigned char toSrgb[LINEAR_STEPS];
+		Tables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < LINEAR_STEPS; i++)
+			{
+				float c = i / (float)(LINEAR_STEPS - 1);
+				float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+				toSrgb[i] = (unsigned char)std::lround(srgb * 255.0f);
+			}
+		}
+	};
+
+	// Helper functions
+
+	const Tables& tables()
+	{
+		static Tables shared;
+		return shared;
+	}
+
+	// Alpha is the last channel of two and four channel images
+	bool isAlpha(int channel, int components)
+	{
+		return (components == 2 || components == 4) && channel == components - 1;
+	}
+
+	void forRows(int rows, bool parallel, const std::function<void(size_t, size_t)>& job)
+	{
+		if (parallel)
+		{
+			workers::parallelFor(rows, job);
+		}
+		else
+		{
+			job(0, rows);
+		}
+	}
+
+	void toLinear(const unsigned char* pixels, int width, int components, float* linear,
+		size_t firstRow, size_t endRow)
+	{
+		const Tables& table = tables();
+		for (size_t i = firstRow * width * components; i < endRow * width * components; i++)
+		{
+			int channel = (int)(i % components);
+			linear[i] = isAlpha(channel, components) ? pixels[i] / 255.0f : table.toLinear[pixels[i]];
+		}
+	}
+
+	void toSrgb(const float* linear, int width, int components, unsigned char* pixels,
+		size_t firstRow, size_t endRow)
+	{
+		const Tables& table = tables();
+		for (size_t i = firstRow * width * components; i < endRow * width * components; i++)
+		{
+			int channel = (int)(i % components);
+			float value = std::min(std::max(linear[i], 0.0f), 1.0f);
+			pixels[i] = isAlpha(channel, components) ? (unsigned char)std::lround(value * 255.0f)
+				: table.toSrgb[std::lround(value * (LINEAR_STEPS - 1))];
+		}
+	}
+
+	// Averages each 2x2 square of the level above. Sizes round down, so an odd
+	// size drops its last row or column. A size of 1 averages its one row or
+	// column with itself.
+	void halveRows(const float* source, int width, int height, int components,
+		float* target, int halfWidth, size_t firstRow, size_t endRow)
+	{
+		size_t rowLength = (size_t)width * components;
+		std::vector<float> rowSum(rowLength);
+		for (size_t y = firstRow; y < endRow; y++)
+		{
+			const float* row0 = source + std::min((int)y * 2, height - 1) * rowLength;
+			const float* row1 = source + std::min((int)y * 2 + 1, height - 1) * rowLength;
+
+			// Sums the two rows, four floats at a time
+			size_t i = 0;
+#ifdef MIPMAPS_SSE2
+			for (; i + 4 <= rowLength; i += 4)
+			{
+				_mm_storeu_ps(rowSum.data() + i, _mm_add_ps(_mm_loadu_ps(row0 + i), _mm_loadu_ps(row1 + i)));
+			}
+#endif
+			for (; i < rowLength; i++)
+			{
+				rowSum[i] = row0[i] + row1[i];
+			}
+
+			float* out = target + y * halfWidth * components;
+			for (int x = 0; x < halfWidth; x++)
+			{
+				const float* left = rowSum.data() + std::min(x * 2, width - 1) * components;
+				const float* right = rowSum.data() + std::min(x * 2 + 1, width - 1) * components;
+				for (int c = 0; c < components; c++)
+				{
+					out[x * components + c] = (left[c] + right[c]) * 0.25f;
+				}
+			}
+		}
+	}
+
+	void generate(const unsigned char* pixels, int width, int height, int components,
+		std::vector<ktx::Level>& levels, bool parallel)
+	{
+		levels.assign(1, ktx::Level());
+		levels.back().width = width;
+		levels.back().height = height;
+		levels.back().data.assign(pixels, pixels + (size_t)width * height * components);
+
+		// Each level is filtered from the linear values of the one above,
+		// not its rounded bytes
+		std::vector<float> linear((size_t)width * height * components);
+		forRows(height, parallel, [&](size_t firstRow, size_t endRow) {
+			toLinear(pixels, width, components, linear.data(), firstRow, endRow);
+		});
+
+		std::vector<float> half;
+		while (width > 1 || height > 1)
+		{
+			int halfWidth = width > 1 ? width / 2 : 1;
+			int halfHeight = height > 1 ? height / 2 : 1;
+			half.resize((size_t)halfWidth * halfHeight * components);
+			ktx::Level level;
+			level.width = halfWidth;
+			level.height = halfHeight;
+			level.data.resize(half.size());
+			forRows(halfHeight, parallel, [&](size_t firstRow, size_t endRow) {
+				halveRows(linear.data(), width, height, components, half.data(), halfWidth, firstRow, endRow);
+				toSrgb(half.data(), halfWidth, components, level.data.data(), firstRow, endRow);
+			});
+			levels.push_back(level);
+			linear.swap(half);
+			width = halfWidth;
+			height = halfHeight;
+		}
+	}
+}
@@ -0,0 +1,35 @@
+/*
+* mipmaps.h
+* This file contains declarations for generating mip chains on the CPU
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include "ktx.h"
+
+// Images are stored in sRGB, so averaging their bytes darkens every
+// level. Color channels are converted to linear light, each level is a
+// 2x2 box filter of the one above it, and the results are converted
+// back. Alpha is already linear and is averaged as is.
+
+namespace mipmaps
+{
+	// Stored in cached mip chains, changing the filter's output must change it
+	const std::string FILTER = "linear box 1";
+
+	// Fills levels with a copy of the image followed by every smaller level
+	// down to 1x1. parallel splits each level's rows across the worker pool
+	// and waits, so only pass it from outside the pool.
+	void generate(const unsigned char* pixels, int width, int height, int components,
+		std::vector<ktx::Level>& levels, bool parallel);
+}
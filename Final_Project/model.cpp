@@ -2,52 +2,444 @@
 
 namespace model
 {
+	// Post processing every preset needs, run by ReadFile itself
+	const unsigned int BASE_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs;
+
+	unsigned int importFlags(ImportPreset preset)
+	{
+		unsigned int flags = BASE_FLAGS;
+		if (preset == ImportPreset::OptimizedRender || preset == ImportPreset::MaxQuality)
+		{
+			flags |= aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality
+				| aiProcess_OptimizeMeshes | aiProcess_OptimizeGraph | aiProcess_SortByPType;
+		}
+		if (preset == ImportPreset::MaxQuality)
+		{
+			flags |= aiProcess_GenSmoothNormals | aiProcess_FindDegenerates | aiProcess_FindInvalidData
+				| aiProcess_RemoveRedundantMaterials | aiProcess_ValidateDataStructure;
+		}
+		return flags;
+	}
+
+	const char* presetName(ImportPreset preset)
+	{
+		if (preset == ImportPreset::FastLoad)
+		{
+			return "fast-load";
+		}
+		if (preset == ImportPreset::MaxQuality)
+		{
+			return "max-quality";
+		}
+		return "optimized-render";
+	}
+
+	bool parsePreset(const std::string& name, ImportPreset& preset)
+	{
+		const ImportPreset presets[] = { ImportPreset::FastLoad, ImportPreset::OptimizedRender, ImportPreset::MaxQuality };
+		for (size_t i = 0; i < 3; i++)
+		{
+			if (name == presetName(presets[i]))
+			{
+				preset = presets[i];
+				return true;
+			}
+		}
+		std::cout << "ERROR: unknown import preset " << name << std::endl;
+		return false;
+	}
+
 	// Helper functions
-	GLuint TextureFromFile(const char* path, const std::string& directory)
+
+	// Mesh cache key, covers every option that changes the imported arrays.
+	// sourceHash comes from meshcache::hashSource, so it covers the materials.
+	uint64_t cacheKey(uint64_t sourceHash, const LoadOptions& options)
+	{
+		uint64_t key = meshcache::combine(sourceHash, importFlags(options.preset));
+		key = meshcache::combine(key, options.optimize);
+		key = meshcache::combine(key, options.lods);
+		// Versions of the passes that rewrote the arrays
+		if (options.optimize)
+		{
+			key = meshcache::combine(key, meshcache::hash(meshopt::VERSION.data(), meshopt::VERSION.size()));
+		}
+		if (options.lods)
+		{
+			key = meshcache::combine(key, meshcache::hash(simplify::VERSION.data(), simplify::VERSION.size()));
+		}
+		return key;
+	}
+
+	struct SceneCounts
+	{
+		size_t meshes, vertices, indices;
+	};
+
+	SceneCounts countScene(const aiScene* scene)
+	{
+		SceneCounts counts{ scene->mNumMeshes, 0, 0 };
+		for (size_t i = 0; i < scene->mNumMeshes; i++)
+		{
+			counts.vertices += scene->mMeshes[i]->mNumVertices;
+			for (size_t f = 0; f < scene->mMeshes[i]->mNumFaces; f++)
+			{
+				counts.indices += scene->mMeshes[i]->mFaces[f].mNumIndices;
+			}
+		}
+		return counts;
+	}
+
+	// Reads a file with the base flags, then applies the rest of the preset
+	// separately so the effect of the extra steps can be logged
+	const aiScene* importScene(Assimp::Importer& importer, const std::string& path, ImportPreset preset,
+		double& readFileMs, double& postProcessMs)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		const aiScene* scene = importer.ReadFile(path, BASE_FLAGS);
+		readFileMs = profiler::elapsedMs(start);
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+		{
+			return NULL;
+		}
+
+		SceneCounts before = countScene(scene);
+		unsigned int extraFlags = importFlags(preset) & ~BASE_FLAGS;
+		if (extraFlags != 0)
+		{
+			// Only triangles are drawn, so point and line meshes are dropped when sorting by type
+			importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+			start = std::chrono::steady_clock::now();
+			scene = importer.ApplyPostProcessing(extraFlags);
+			postProcessMs = profiler::elapsedMs(start);
+			if (!scene || !scene->mRootNode)
+			{
+				return NULL;
+			}
+		}
+
+		SceneCounts after = countScene(scene);
+		std::cout << "Imported " << path << " (" << presetName(preset) << ", "
+			<< readFileMs << " ms read, " << postProcessMs << " ms post processing): "
+			<< "meshes " << before.meshes << " -> " << after.meshes
+			<< ", vertices " << before.vertices << " -> " << after.vertices
+			<< ", indices " << before.indices << " -> " << after.indices << std::endl;
+		return scene;
+	}
+
+	// Number of indices in all faces of a mesh
+	size_t countIndices(const aiMesh* mesh)
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < mesh->mNumFaces; i++)
+		{
+			count += mesh->mFaces[i].mNumIndices;
+		}
+		return count;
+	}
+
+	// Interleaves Assimp's separate arrays into one mesh::Vertex
+	mesh::Vertex makeVertex(const aiMesh* mesh, size_t i)
+	{
+		mesh::Vertex vertex;
+		vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+		if (mesh->HasNormals())
+		{
+			vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+		}
+		if (mesh->mTextureCoords[0]) // if it has texture coords
+		{
+			vertex.texture = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+		}
+		return vertex;
+	}
+
+	// Each vertex is written whole and in order so the destination can be mapped GPU memory
+	void fillVertices(const aiMesh* mesh, mesh::Vertex* out)
+	{
+		for (size_t i = 0; i < mesh->mNumVertices; i++)
+		{
+			out[i] = makeVertex(mesh, i);
+		}
+	}
+
+	void fillPackedVertices(const aiMesh* mesh, const glm::vec3& scale, const glm::vec3& offset, mesh::PackedVertex* out)
+	{
+		for (size_t i = 0; i < mesh->mNumVertices; i++)
+		{
+			out[i] = quantize::packVertex(makeVertex(mesh, i), scale, offset);
+		}
+	}
+
+	// Bounds of the positions, read before anything is written so packed
+	// vertices can go straight into mapped memory
+	void positionBounds(const aiMesh* mesh, glm::vec3& boundsMin, glm::vec3& boundsMax)
+	{
+		boundsMin = glm::vec3(0.0f);
+		boundsMax = glm::vec3(0.0f);
+		for (size_t i = 0; i < mesh->mNumVertices; i++)
+		{
+			glm::vec3 position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+			boundsMin = i == 0 ? position : glm::min(boundsMin, position);
+			boundsMax = i == 0 ? position : glm::max(boundsMax, position);
+		}
+	}
+
+	void fillIndices(const aiMesh* mesh, GLuint* out)
+	{
+		for (size_t i = 0; i < mesh->mNumFaces; i++)
+		{
+			const aiFace& face = mesh->mFaces[i];
+			for (size_t j = 0; j < face.mNumIndices; j++)
+			{
+				*out++ = face.mIndices[j];
+			}
+		}
+	}
+
+	// Reorders a mesh's triangles and vertices in place for the vertex cache,
+	// overdraw and vertex fetch, before it is converted and uploaded
+	void optimizeMesh(aiMesh* mesh, meshopt::CacheStats& before, meshopt::CacheStats& after)
+	{
+		std::vector<GLuint> indices(countIndices(mesh));
+		fillIndices(mesh, indices.data());
+		before = meshopt::analyzeVertexCache(indices.data(), indices.size(), mesh->mNumVertices);
+		after = before;
+
+		// Only plain triangle lists, animation data is indexed by the old vertex order
+		if (indices.size() != (size_t)mesh->mNumFaces * 3 || mesh->HasBones() || mesh->mNumAnimMeshes > 0)
+		{
+			return;
+		}
+
+		std::vector<GLuint> ordered(indices.size());
+		std::vector<size_t> clusters = meshopt::optimizeVertexCache(ordered.data(), indices.data(), indices.size(),
+			mesh->mNumVertices);
+		meshopt::optimizeOverdraw(ordered.data(), ordered.size(), (const float*)mesh->mVertices, sizeof(aiVector3D), clusters);
+
+		std::vector<GLuint> remap;
+		size_t used = meshopt::optimizeVertexFetch(remap, ordered.data(), ordered.size(), mesh->mNumVertices);
+		meshopt::remapVertices(mesh->mVertices, mesh->mNumVertices, remap);
+		if (mesh->HasNormals())
+		{
+			meshopt::remapVertices(mesh->mNormals, mesh->mNumVertices, remap);
+		}
+		if (mesh->HasTangentsAndBitangents())
+		{
+			meshopt::remapVertices(mesh->mTangents, mesh->mNumVertices, remap);
+			meshopt::remapVertices(mesh->mBitangents, mesh->mNumVertices, remap);
+		}
+		for (size_t c = 0; c < AI_MAX_NUMBER_OF_TEXTURECOORDS; c++)
+		{
+			if (mesh->mTextureCoords[c])
+			{
+				meshopt::remapVertices(mesh->mTextureCoords[c], mesh->mNumVertices, remap);
+			}
+		}
+		for (size_t c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS; c++)
+		{
+			if (mesh->mColors[c])
+			{
+				meshopt::remapVertices(mesh->mColors[c], mesh->mNumVertices, remap);
+			}
+		}
+		mesh->mNumVertices = (unsigned int)used;
+
+		for (size_t f = 0; f < mesh->mNumFaces; f++)
+		{
+			for (size_t c = 0; c < 3; c++)
+			{
+				mesh->mFaces[f].mIndices[c] = ordered[f * 3 + c];
+			}
+		}
+		after = meshopt::analyzeVertexCache(ordered.data(), ordered.size(), used);
+	}
+
+	// Optimizes every mesh of an imported scene and logs the cache statistics
+	void optimizeScene(const aiScene* scene, const std::string& path, double& optimizeMs)
 	{
-		std::string filename = std::string(path);
-		filename = directory + '/' + filename;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		meshopt::CacheStats before, after;
+		for (size_t i = 0; i < scene->mNumMeshes; i++)
+		{
+			meshopt::CacheStats meshBefore, meshAfter;
+			optimizeMesh(scene->mMeshes[i], meshBefore, meshAfter);
+			before.add(meshBefore);
+			after.add(meshAfter);
+		}
+		optimizeMs = profiler::elapsedMs(start);
 
-		GLuint textureID;
-		glGenTextures(1, &textureID);
+		std::cout << "Optimized " << path << " (" << optimizeMs << " ms): "
+			<< "ACMR " << before.acmr() << " -> " << after.acmr()
+			<< ", ATVR " << before.atvr() << " -> " << after.atvr() << std::endl;
+	}
 
-		int width, height, nrComponents;
+	void expandBounds(glm::vec3& boundsMin, glm::vec3& boundsMax, bool& empty, const glm::vec3& position)
+	{
+		boundsMin = empty ? position : glm::min(boundsMin, position);
+		boundsMax = empty ? position : glm::max(boundsMax, position);
+		empty = false;
+	}
 
-		unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-		if (data)
+	void sceneBounds(const aiScene* scene, glm::vec3& boundsMin, glm::vec3& boundsMax)
+	{
+		bool empty = true;
+		for (size_t i = 0; i < scene->mNumMeshes; i++)
 		{
-			GLenum format{};
-			if (nrComponents == 1)
+			const aiMesh* mesh = scene->mMeshes[i];
+			for (size_t v = 0; v < mesh->mNumVertices; v++)
 			{
-				format = GL_RED;
+				expandBounds(boundsMin, boundsMax, empty,
+					glm::vec3(mesh->mVertices[v].x, mesh->mVertices[v].y, mesh->mVertices[v].z));
 			}
-			else if (nrComponents == 3)
+		}
+	}
+
+	void viewBounds(const std::vector<meshcache::MeshView>& views, glm::vec3& boundsMin, glm::vec3& boundsMax)
+	{
+		bool empty = true;
+		for (size_t i = 0; i < views.size(); i++)
+		{
+			for (size_t v = 0; v < views.at(i).vertexCount; v++)
 			{
-				format = GL_RGB;
+				expandBounds(boundsMin, boundsMax, empty, views.at(i).vertices[v].position);
 			}
-			else if (nrComponents == 4)
+		}
+	}
+
+	// Everything an asynchronous import produces before touching the GPU.
+	// The mesh views point either into the mapped mesh cache or into the owned arrays.
+	struct StagedModel
+	{
+		meshcache::MappedFile file;
+		std::vector<meshcache::MeshView> views;
+		std::vector<std::vector<mesh::Vertex>> vertices;
+		std::vector<std::vector<GLuint>> indices;
+		glm::vec3 boundsMin, boundsMax;
+		double readFileMs, postProcessMs, optimizeMs, lodMs, processMs;
+		bool fromCache;
+		std::string error;
+		StagedModel() : boundsMin{ 0.0f }, boundsMax{ 0.0f }, readFileMs{ 0.0 }, postProcessMs{ 0.0 }, optimizeMs{ 0.0 },
+			lodMs{ 0.0 }, processMs{ 0.0 }, fromCache{ false } {}
+	};
+
+	void addTextureRefs(aiMaterial* mat, aiTextureType type, const std::string& typeName,
+		std::vector<meshcache::TextureRef>& refs)
+	{
+		for (size_t i = 0; i < mat->GetTextureCount(type); i++)
+		{
+			aiString str;
+			mat->GetTexture(type, i, &str);
+			meshcache::TextureRef ref;
+			ref.type = typeName;
+			ref.path = std::string(str.C_Str());
+			refs.push_back(ref);
+		}
+	}
+
+	// Converts the meshes in the same order as Model::processNode
+	void stageNode(aiNode* node, const aiScene* scene, StagedModel& staged, const LoadOptions& options)
+	{
+		for (size_t i = 0; i < node->mNumMeshes; i++)
+		{
+			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+			staged.vertices.push_back(std::vector<mesh::Vertex>(mesh->mNumVertices));
+			staged.indices.push_back(std::vector<GLuint>(countIndices(mesh)));
+			fillVertices(mesh, staged.vertices.back().data());
+			fillIndices(mesh, staged.indices.back().data());
+
+			meshcache::MeshView view;
+			if (options.lods)
 			{
-				format = GL_RGBA;
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				view.lods = simplify::buildLods(staged.indices.back(), (const float*)mesh->mVertices,
+					sizeof(aiVector3D), mesh->mNumVertices);
+				staged.lodMs += profiler::elapsedMs(start);
 			}
+			aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+			addTextureRefs(material, aiTextureType_DIFFUSE, "texture_diffuse", view.textures);
+			addTextureRefs(material, aiTextureType_SPECULAR, "texture_specular", view.textures);
+			staged.views.push_back(view);
+		}
+
+		for (size_t i = 0; i < node->mNumChildren; i++)
+		{
+			stageNode(node->mChildren[i], scene, staged, options);
+		}
+	}
 
-			glBindTexture(GL_TEXTURE_2D, textureID);
-			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-			glGenerateMipmap(GL_TEXTURE_2D);
+	// Imports a model without any GL calls so it can run on a worker thread
+	std::shared_ptr<StagedModel> stageModel(const std::string& path, LoadOptions options)
+	{
+		std::shared_ptr<StagedModel> staged = std::make_shared<StagedModel>();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		uint64_t sourceHash = 0;
+		uint64_t key = 0;
+		if (options.useMeshCache)
+		{
+			sourceHash = meshcache::hashSource(path);
+			key = cacheKey(sourceHash, options);
+		}
 
-			stbi_image_free(data);
+		if (sourceHash != 0 && staged->file.open(meshcache::cachePath(path))
+			&& meshcache::read(staged->file, key, staged->views))
+		{
+			staged->fromCache = true;
+			staged->readFileMs = profiler::elapsedMs(start);
 		}
 		else
 		{
-			std::cout << "Texture failed to load at path: " << path << std::endl;
-			stbi_image_free(data);
+			staged->file.close();
+			staged->views.clear();
+
+			Assimp::Importer importer;
+			const aiScene* scene = importScene(importer, path, options.preset, staged->readFileMs, staged->postProcessMs);
+			if (!scene)
+			{
+				staged->error = importer.GetErrorString();
+				return staged;
+			}
+
+			if (options.optimize)
+			{
+				optimizeScene(scene, path, staged->optimizeMs);
+			}
+
+			start = std::chrono::steady_clock::now();
+			stageNode(scene->mRootNode, scene, *staged, options);
+			for (size_t i = 0; i < staged->views.size(); i++)
+			{
+				meshcache::MeshView& view = staged->views.at(i);
+				view.vertices = staged->vertices.at(i).data();
+				view.vertexCount = (uint32_t)staged->vertices.at(i).size();
+				view.indices = staged->indices.at(i).data();
+				view.indexCount = (uint32_t)staged->indices.at(i).size();
+			}
+
+			if (sourceHash != 0)
+			{
+				meshcache::Writer writer;
+				if (writer.open(meshcache::cachePath(path), key))
+				{
+					for (size_t i = 0; i < staged->views.size(); i++)
+					{
+						const meshcache::MeshView& view = staged->views.at(i);
+						std::vector<mesh::Texture> textures(view.textures.size());
+						for (size_t t = 0; t < view.textures.size(); t++)
+						{
+							textures.at(t).type = view.textures.at(t).type;
+							textures.at(t).path = view.textures.at(t).path;
+						}
+						writer.add(view.vertices, view.vertexCount, view.indices, view.indexCount, textures, view.lods);
+					}
+					writer.close();
+				}
+			}
+			staged->processMs = profiler::elapsedMs(start) - staged->lodMs;
 		}
 
-		return textureID;
+		viewBounds(staged->views, staged->boundsMin, staged->boundsMax);
+		return staged;
 	}
 
 	void Model::scale(GLfloat x, GLfloat y, GLfloat z)
@@ -87,101 +479,613 @@ namespace model
 	}
 
 	// Model class
-	void Model::draw(shaders::Shader shader)
+	void Model::addInstance(const glm::mat4& transform)
+	{
+		instances.push_back(transform);
+		instancesChanged = true;
+	}
+
+	void Model::setInstance(size_t index, const glm::mat4& transform)
 	{
-		GLuint modelLoc = glGetUniformLocation(shader.ID, "model");
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(this->model));
+		instances.at(index) = transform;
+		instancesChanged = true;
+	}
+
+	void Model::clearInstances()
+	{
+		instances.clear();
+		instancesChanged = true;
+	}
+
+	void Model::draw(shaders::Shader& shader)
+	{
+		glstats::ScopedCaller caller{ "Model::draw" };
+		updateInstances();
+
+		// Asynchronous loads show a bounding box until every texture is uploaded
+		if (state != LoadState::Ready)
+		{
+			update();
+			if (state == LoadState::Uploading)
+			{
+				drawPlaceholder(shader);
+			}
+			if (state != LoadState::Ready)
+			{
+				return;
+			}
+		}
 
 		for (size_t i = 0; i < meshes.size(); i++)
 		{
-			meshes.at(i).draw(shader);
+			meshes.at(i).draw(shader, instanceBuffer);
 		}
 	}
 
+	Model::~Model()
+	{
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			meshes.at(i).release();
+
+			// Drops this model's references, the cache frees layers nothing else uses
+			std::vector<mesh::Texture>& textures = meshes.at(i).textures;
+			for (size_t t = 0; t < textures.size(); t++)
+			{
+				if (textures.at(t).array != 0)
+				{
+					textures::Layer layer;
+					layer.array = textures.at(t).array;
+					layer.layer = textures.at(t).layer;
+					textures::cache().release(layer);
+				}
+			}
+		}
+		deletePlaceholder();
+		instanceBuffer.release();
+	}
+
+	void Model::draw(shaders::Shader& shader, const glm::vec3& cameraPos, float pixelsPerUnit)
+	{
+		if (state == LoadState::Ready)
+		{
+			updateInstances();
+			selectLod(cameraPos, pixelsPerUnit);
+		}
+		draw(shader);
+	}
+
+	size_t Model::submit(renderqueue::Queue& queue, shaders::Shader& shader, const glm::vec3& cameraPos, float pixelsPerUnit)
+	{
+		updateInstances();
+		if (state != LoadState::Ready)
+		{
+			update();
+			size_t drawn = 0;
+			if (state == LoadState::Uploading && drawPlaceholder(shader))
+			{
+				drawn++;
+			}
+			if (state != LoadState::Ready)
+			{
+				return drawn;
+			}
+		}
+
+		float distance = selectLod(cameraPos, pixelsPerUnit);
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			queue.submit(renderqueue::Pass::Opaque, shader, &instanceBuffer, &meshes.at(i), distance);
+		}
+		return 0;
+	}
+
 	void Model::loadModel(std::string path)
 	{
-		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+		loadStart = std::chrono::steady_clock::now();
+		gpumem::ScopedOwner owner{ path };
+		source = path;
+		directory = path.substr(0, path.find_last_of('/'));
 
-		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+		// Warm starts map the mesh cache instead of running Assimp
+		uint64_t sourceHash = 0;
+		uint64_t key = 0;
+		if (options.useMeshCache)
 		{
-			std::cout << "ERROR: " << importer.GetErrorString() << std::endl;
-			return;
+			sourceHash = meshcache::hashSource(path);
+			key = cacheKey(sourceHash, options);
 		}
+		std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+		if (sourceHash != 0 && loadCached(path, key))
+		{
+			loadStats.fromCache = true;
+		}
+		else
+		{
+			Assimp::Importer importer;
+			const aiScene* scene = importScene(importer, path, options.preset, loadStats.readFileMs, loadStats.postProcessMs);
+			if (!scene)
+			{
+				std::cout << "ERROR: " << importer.GetErrorString() << std::endl;
+				state = LoadState::Failed;
+				return;
+			}
+
+			if (options.optimize)
+			{
+				optimizeScene(scene, path, loadStats.optimizeMs);
+			}
+
+			processStart = std::chrono::steady_clock::now();
+			sceneBounds(scene, boundsMin, boundsMax);
+			decodeTextures(scene);
+			meshes.reserve(scene->mNumMeshes);
+
+			// processMesh adds every mesh to a new mesh cache as it goes
+			meshcache::Writer writer;
+			if (sourceHash != 0 && writer.open(meshcache::cachePath(path), key))
+			{
+				cacheWriter = &writer;
+			}
+			processNode(scene->mRootNode, scene);
+			if (cacheWriter)
+			{
+				writer.close();
+				cacheWriter = NULL;
+			}
+			std::vector<mesh::Vertex>().swap(cacheVertices);
+		}
+		uploadTextures(true);
+
+		// Conversion time is whatever processNode spent outside of textures, LODs and uploads
+		loadStats.processMs = profiler::elapsedMs(processStart) - loadStats.materialsMs - loadStats.lodMs
+			- loadStats.meshUploadMs;
+		finishLoad();
+	}
+
+	void Model::finishLoad()
+	{
+		// Frees the decoded pixels once everything is uploaded
+		std::map<std::string, std::shared_future<textures::Image>>::iterator it;
+		for (it = decoding.begin(); it != decoding.end(); it++)
+		{
+			loadStats.decodeMs += it->second.get().decodeMs;
+			textures::release(it->second.get());
+		}
+		decoding.clear();
+
+		loadStats.meshes = meshes.size();
+		loadStats.totalMs = profiler::elapsedMs(loadStart);
+		state = LoadState::Ready;
+	}
 
+	void Model::loadAsync(std::string path)
+	{
+		loadStart = std::chrono::steady_clock::now();
+		source = path;
 		directory = path.substr(0, path.find_last_of('/'));
-		processNode(scene->mRootNode, scene);
+		LoadOptions importOptions = options;
+		staging = workers::pool().submit(
+			[path, importOptions]() { return stageModel(path, importOptions); });
 	}
 
-	void Model::processNode(aiNode* node, const aiScene* scene)
+	void Model::update()
 	{
-		for (size_t i = 0; i < node->mNumMeshes; i++)
+		if (state == LoadState::Loading && staging.valid()
+			&& staging.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
 		{
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			meshes.push_back(processMesh(mesh, scene));
+			std::shared_ptr<StagedModel> staged = staging.get();
+			if (!staged->error.empty())
+			{
+				std::cout << "ERROR: " << staged->error << std::endl;
+				state = LoadState::Failed;
+				return;
+			}
+			finishStaging(*staged);
 		}
 
-		for (size_t i = 0; i < node->mNumChildren; i++)
+		if (state == LoadState::Uploading && uploadTextures(false))
 		{
-			processNode(node->mChildren[i], scene);
+			deletePlaceholder();
+			finishLoad();
 		}
 	}
 
-	mesh::Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+	void Model::wait()
 	{
-		std::vector<mesh::Vertex> vertices;
-		std::vector<GLuint> indices;
-		std::vector<mesh::Texture> textures;
+		if (state == LoadState::Loading && staging.valid())
+		{
+			staging.wait();
+			update();
+		}
+		if (state == LoadState::Uploading)
+		{
+			uploadTextures(true);
+			update();
+		}
+	}
 
-		// Processes vertices
-		for (size_t i = 0; i < mesh->mNumVertices; i++)
+	void Model::finishStaging(const StagedModel& staged)
+	{
+		// Uploads the meshes now, their textures follow once the workers have decoded them all
+		gpumem::ScopedOwner owner{ source };
+		loadStats.readFileMs = staged.readFileMs;
+		loadStats.postProcessMs = staged.postProcessMs;
+		loadStats.optimizeMs = staged.optimizeMs;
+		loadStats.lodMs = staged.lodMs;
+		loadStats.processMs = staged.processMs;
+		loadStats.fromCache = staged.fromCache;
+
+		for (size_t i = 0; i < staged.views.size(); i++)
 		{
-			// position
-			mesh::Vertex vertex;
-			glm::vec3 vec;
-			vec.x = mesh->mVertices[i].x;
-			vec.y = mesh->mVertices[i].y;
-			vec.z = mesh->mVertices[i].z;
-			vertex.position = vec;
+			for (size_t t = 0; t < staged.views.at(i).textures.size(); t++)
+			{
+				queueDecode(directory + '/' + staged.views.at(i).textures.at(t).path);
+			}
+		}
 
-			// normals
-			if (mesh->HasNormals())
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < staged.views.size(); i++)
+		{
+			const meshcache::MeshView& view = staged.views.at(i);
+			std::vector<mesh::Texture> textures(view.textures.size());
+			for (size_t t = 0; t < view.textures.size(); t++)
 			{
-				vec.x = mesh->mNormals[i].x;
-				vec.y = mesh->mNormals[i].y;
-				vec.z = mesh->mNormals[i].z;
-				vertex.normal = vec;
+				textures.at(t).type = view.textures.at(t).type;
+				textures.at(t).path = view.textures.at(t).path;
 			}
-			else
+			meshes.push_back(mesh::Mesh{ view.vertices, view.vertexCount, view.indices, view.indexCount, textures,
+				options.vertexFormat });
+			if (!view.lods.empty())
 			{
-				vertex.normal = glm::vec3(0.0f);
+				meshes.back().lods = view.lods;
 			}
+		}
+		loadStats.meshUploadMs += profiler::elapsedMs(start);
 
-			// texture coordinates
-			if (mesh->mTextureCoords[0]) // if it has texture coords
+		boundsMin = staged.boundsMin;
+		boundsMax = staged.boundsMax;
+		createPlaceholder(boundsMin, boundsMax);
+		state = LoadState::Uploading;
+	}
+
+	bool Model::uploadTextures(bool block)
+	{
+		// Nothing is uploaded until every image is decoded, so the first
+		// texture array of each size and format has room for all of them
+		std::map<std::string, std::shared_future<textures::Image>>::iterator it;
+		for (it = decoding.begin(); it != decoding.end(); it++)
+		{
+			if (block)
 			{
-				glm::vec2 vec2;
-				vec2.x = mesh->mTextureCoords[0][i].x;
-				vec2.y = mesh->mTextureCoords[0][i].y;
-				vertex.texture = vec2;
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				it->second.wait();
+				double waitMs = profiler::elapsedMs(start);
+				loadStats.decodeWaitMs += waitMs;
+				loadStats.materialsMs += waitMs;
 			}
-			else 
+			else if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
 			{
-				vertex.texture = glm::vec2(0.0f);
+				return false;
 			}
+		}
+		for (it = decoding.begin(); it != decoding.end(); it++)
+		{
+			if (!textures::cache().contains(textures::TextureCache::key(it->first)))
+			{
+				texturearrays::expect(it->second.get());
+			}
+		}
 
-			vertices.push_back(vertex);
+		// Texture arrays stay 0 until the image is uploaded
+		gpumem::ScopedOwner owner{ source };
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			std::vector<mesh::Texture>& textures = meshes.at(i).textures;
+			for (size_t t = 0; t < textures.size(); t++)
+			{
+				if (textures.at(t).array != 0)
+				{
+					continue;
+				}
+
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				textures.at(t) = loadTexture(textures.at(t).path, textures.at(t).type);
+				loadStats.materialsMs += profiler::elapsedMs(start);
+			}
 		}
+		return true;
+	}
 
-		// Process indices
-		for (size_t i = 0; i < mesh->mNumFaces; i++)
+	void Model::createPlaceholder(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		// Corners of the bounding box, the normal only keeps the lighting defined
+		std::vector<mesh::Vertex> corners;
+		for (size_t i = 0; i < 8; i++)
 		{
-			aiFace face = mesh->mFaces[i];
-			for (size_t j = 0; j < face.mNumIndices; j++)
-				indices.push_back(face.mIndices[j]);
+			glm::vec3 corner{ (i & 1) ? boundsMax.x : boundsMin.x,
+				(i & 2) ? boundsMax.y : boundsMin.y,
+				(i & 4) ? boundsMax.z : boundsMin.z };
+			corners.push_back(mesh::Vertex(corner, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.0f)));
+		}
+		// Twelve edges, each joins corners that differ in one bit
+		const GLubyte edges[] = {
+			0, 1, 2, 3, 4, 5, 6, 7,
+			0, 2, 1, 3, 4, 6, 5, 7,
+			0, 4, 1, 5, 2, 6, 3, 7
+		};
+
+		glGenVertexArrays(1, &placeholderVAO);
+		glGenBuffers(1, &placeholderVBO);
+		glGenBuffers(1, &placeholderEBO);
+		glstate::bindVertexArray(placeholderVAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, placeholderVBO);
+		glBufferData(GL_ARRAY_BUFFER, corners.size() * sizeof(mesh::Vertex), &corners[0], GL_STATIC_DRAW);
+		gpumem::trackBuffer(placeholderVBO, gpumem::Kind::Vertex, corners.size() * sizeof(mesh::Vertex));
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, placeholderEBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(edges), edges, GL_STATIC_DRAW);
+		gpumem::trackBuffer(placeholderEBO, gpumem::Kind::Index, sizeof(edges));
+
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(mesh::Vertex), (void*)offsetof(mesh::Vertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(mesh::Vertex), (void*)offsetof(mesh::Vertex, normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(mesh::Vertex), (void*)offsetof(mesh::Vertex, texture));
+		mesh::instanceAttributes();
+	}
+
+	bool Model::drawPlaceholder(shaders::Shader& shader)
+	{
+		if (placeholderVAO == 0 || instanceBuffer.count == 0)
+		{
+			return false;
+		}
+		// No texture is bound, so the box is drawn dark
+		shader.use();
+		mesh::setDequantization(shader, glm::vec3(1.0f), glm::vec3(0.0f), false);
+		texturearrays::bind(0);
+		glstate::bindVertexArray(placeholderVAO);
+		glstate::instanceBuffer(mesh::INSTANCE_LOCATION, instanceBuffer.ID);
+		glDrawElementsInstanced(GL_LINES, 24, GL_UNSIGNED_BYTE, 0, instanceBuffer.count);
+		return true;
+	}
+
+	void Model::deletePlaceholder()
+	{
+		if (placeholderVAO == 0)
+		{
+			return;
 		}
+		glDeleteVertexArrays(1, &placeholderVAO);
+		glstate::deletedVertexArray(placeholderVAO);
+		glDeleteBuffers(1, &placeholderVBO);
+		glDeleteBuffers(1, &placeholderEBO);
+		gpumem::release(placeholderVBO, gpumem::Kind::Vertex);
+		gpumem::release(placeholderEBO, gpumem::Kind::Index);
+		placeholderVAO = 0;
+	}
+
+	void Model::updateInstances()
+	{
+		if (!instancesChanged && model == uploadedModel)
+		{
+			return;
+		}
+		transforms.resize(instances.size());
+		for (size_t i = 0; i < instances.size(); i++)
+		{
+			transforms.at(i) = instances.at(i) * model;
+		}
+
+		// Added or removed copies invalidate the last order and its ranges
+		if (instanceOrder.size() != transforms.size())
+		{
+			instanceOrder.resize(transforms.size());
+			for (size_t i = 0; i < instanceOrder.size(); i++)
+			{
+				instanceOrder.at(i) = (uint32_t)i;
+			}
+			for (size_t i = 0; i < meshes.size(); i++)
+			{
+				meshes.at(i).lodInstances.clear();
+			}
+		}
+		uploadInstances();
+		uploadedModel = model;
+		instancesChanged = false;
+	}
+
+	void Model::uploadInstances()
+	{
+		std::vector<glm::mat4> ordered(instanceOrder.size());
+		for (size_t i = 0; i < instanceOrder.size(); i++)
+		{
+			ordered.at(i) = transforms.at(instanceOrder.at(i));
+		}
+		gpumem::ScopedOwner owner{ source };
+		instanceBuffer.update(ordered.data(), (GLsizei)ordered.size());
+	}
+
+	float Model::selectLod(const glm::vec3& cameraPos, float pixelsPerUnit)
+	{
+		// Treats every copy as its bounding sphere, so the distance is to the
+		// nearest point it could have
+		glm::vec3 localCenter = (boundsMin + boundsMax) * 0.5f;
+		float localRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+		std::vector<float> pixelsPerError(transforms.size());
+		float nearest = std::numeric_limits<float>::max();
+		for (size_t i = 0; i < transforms.size(); i++)
+		{
+			const glm::mat4& transform = transforms.at(i);
+			glm::vec3 center = glm::vec3(transform * glm::vec4(localCenter, 1.0f));
+			float scale = glm::max(glm::length(glm::vec3(transform[0])),
+				glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+			float centerDistance = glm::length(cameraPos - center);
+			float distance = glm::max(centerDistance - localRadius * scale, 0.1f);
+			pixelsPerError.at(i) = scale * pixelsPerUnit / distance;
+			nearest = glm::min(nearest, centerDistance);
+		}
+
+		// Starts from the last order, so copies that tie keep their places
+		// and a still camera uploads nothing
+		std::vector<uint32_t> order = instanceOrder;
+		std::stable_sort(order.begin(), order.end(), [&pixelsPerError](uint32_t a, uint32_t b) {
+			return pixelsPerError[a] > pixelsPerError[b];
+		});
+
+		instanceLods.resize(meshes.size());
+		for (size_t m = 0; m < meshes.size(); m++)
+		{
+			mesh::Mesh& mesh = meshes.at(m);
+			std::vector<size_t>& levels = instanceLods.at(m);
+			levels.resize(transforms.size(), 0);
+			for (size_t i = 0; i < transforms.size(); i++)
+			{
+				size_t lod = glm::min(levels.at(i), mesh.lods.size() - 1);
+				while (lod > 0 && mesh.lods.at(lod).error * pixelsPerError.at(i) > LOD_PIXEL_ERROR)
+				{
+					lod--;
+				}
+				while (lod + 1 < mesh.lods.size()
+					&& mesh.lods.at(lod + 1).error * pixelsPerError.at(i) <= LOD_PIXEL_ERROR * LOD_HYSTERESIS)
+				{
+					lod++;
+				}
+				levels.at(i) = lod;
+			}
+
+			// Hysteresis can leave a copy coarser than one that needs less
+			// detail. Those get the finer level, so each level's copies sit
+			// next to each other in the sorted buffer.
+			size_t finest = mesh.lods.size() - 1;
+			for (size_t p = order.size(); p > 0; p--)
+			{
+				size_t& level = levels.at(order.at(p - 1));
+				finest = glm::min(finest, level);
+				level = finest;
+			}
+
+			mesh.lodInstances.assign(mesh.lods.size(), mesh::InstanceRange{ 0, 0 });
+			for (size_t p = 0; p < order.size(); p++)
+			{
+				mesh.lodInstances.at(levels.at(order.at(p))).count++;
+			}
+			GLsizei first = 0;
+			for (size_t level = 0; level < mesh.lodInstances.size(); level++)
+			{
+				mesh.lodInstances.at(level).first = first;
+				first += mesh.lodInstances.at(level).count;
+			}
+			mesh.lod = order.empty() ? 0 : levels.at(order.front());
+		}
+
+		if (order != instanceOrder)
+		{
+			instanceOrder.swap(order);
+			uploadInstances();
+		}
+		return nearest;
+	}
+
+	bool Model::loadCached(const std::string& path, uint64_t key)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		meshcache::MappedFile file;
+		std::vector<meshcache::MeshView> views;
+		if (!file.open(meshcache::cachePath(path)) || !meshcache::read(file, key, views))
+		{
+			return false;
+		}
+		loadStats.readFileMs = profiler::elapsedMs(start);
+		viewBounds(views, boundsMin, boundsMax);
+
+		for (size_t i = 0; i < views.size(); i++)
+		{
+			for (size_t t = 0; t < views.at(i).textures.size(); t++)
+			{
+				queueDecode(directory + '/' + views.at(i).textures.at(t).path);
+			}
+		}
+
+		for (size_t i = 0; i < views.size(); i++)
+		{
+			const meshcache::MeshView& view = views.at(i);
+
+			// Textures are uploaded by uploadTextures once every image is decoded
+			std::vector<mesh::Texture> textures(view.textures.size());
+			for (size_t t = 0; t < view.textures.size(); t++)
+			{
+				textures.at(t).type = view.textures.at(t).type;
+				textures.at(t).path = view.textures.at(t).path;
+			}
+
+			// Uploads straight from the mapping
+			start = std::chrono::steady_clock::now();
+			meshes.push_back(mesh::Mesh{ view.vertices, view.vertexCount, view.indices, view.indexCount, textures,
+				options.vertexFormat });
+			if (!view.lods.empty())
+			{
+				meshes.back().lods = view.lods;
+			}
+			loadStats.meshUploadMs += profiler::elapsedMs(start);
+		}
+		return true;
+	}
+
+	void Model::queueDecode(const std::string& filename)
+	{
+		if (decoding.count(filename) == 0 && !textures::cache().contains(textures::TextureCache::key(filename)))
+		{
+			// The driver is queried here, workers have no GL context
+			bool compress = options.compressTextures && textures::supportsCompression();
+			decoding[filename] = workers::pool().submit(
+				[filename, compress]() { return textures::decode(filename, compress); }).share();
+		}
+	}
+
+	void Model::decodeTextures(const aiScene* scene)
+	{
+		// Starts decoding every diffuse and specular image the materials
+		// reference on the worker pool, while the meshes are converted
+		const aiTextureType types[] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR };
+		for (size_t i = 0; i < scene->mNumMaterials; i++)
+		{
+			aiMaterial* material = scene->mMaterials[i];
+			for (size_t t = 0; t < 2; t++)
+			{
+				for (size_t j = 0; j < material->GetTextureCount(types[t]); j++)
+				{
+					aiString str;
+					material->GetTexture(types[t], j, &str);
+					queueDecode(directory + '/' + std::string(str.C_Str()));
+				}
+			}
+		}
+	}
+
+	void Model::processNode(aiNode* node, const aiScene* scene)
+	{
+		for (size_t i = 0; i < node->mNumMeshes; i++)
+		{
+			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+			meshes.push_back(processMesh(mesh, scene));
+		}
+
+		for (size_t i = 0; i < node->mNumChildren; i++)
+		{
+			processNode(node->mChildren[i], scene);
+		}
+	}
+
+	mesh::Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+	{
+		std::vector<mesh::Texture> textures;
 
 		// Process materials
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 		if (mesh->mMaterialIndex >= 0)
 		{
 			aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
@@ -196,8 +1100,84 @@ namespace model
 				"texture_specular");
 			textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 		}
+		loadStats.materialsMs += profiler::elapsedMs(start);
+
+		// Converts straight into mapped buffers unless a copy is kept
+		bool mapped = options.zeroCopy;
+
+		// Indices always go through a vector, the upload narrows them to the smallest type
+		std::vector<GLuint> indices(countIndices(mesh));
+		fillIndices(mesh, indices.data());
+		std::vector<mesh::Lod> lods;
+		if (options.lods)
+		{
+			start = std::chrono::steady_clock::now();
+			lods = simplify::buildLods(indices, (const float*)mesh->mVertices, sizeof(aiVector3D), mesh->mNumVertices);
+			loadStats.lodMs += profiler::elapsedMs(start);
+		}
+
+		// The GPU copy can't be read back cheaply, so a new mesh cache gets its
+		// own conversion into a scratch vector reused by every mesh
+		if (cacheWriter)
+		{
+			cacheVertices.resize(mesh->mNumVertices);
+			fillVertices(mesh, cacheVertices.data());
+			cacheWriter->add(cacheVertices.data(), (uint32_t)cacheVertices.size(), indices.data(), (uint32_t)indices.size(),
+				textures, lods);
+		}
+
+		if (!mapped)
+		{
+			// Converts into a vector the mesh keeps
+			std::vector<mesh::Vertex> vertices(mesh->mNumVertices);
+			fillVertices(mesh, vertices.data());
+
+			start = std::chrono::steady_clock::now();
+			mesh::Mesh result{ vertices, indices, textures, options.vertexFormat };
+			if (!lods.empty())
+			{
+				result.lods = lods;
+			}
+			loadStats.meshUploadMs += profiler::elapsedMs(start);
+			return result;
+		}
 
-		return mesh::Mesh(vertices, indices, textures);
+		// Sizes the vertex buffer first and converts straight into mapped buffer memory
+		start = std::chrono::steady_clock::now();
+		mesh::Mesh result{ NULL, mesh->mNumVertices, indices.data(), indices.size(), textures, options.vertexFormat };
+		bool filled = false;
+		if (options.vertexFormat == mesh::VertexFormat::Packed)
+		{
+			// Packing needs the bounds before the first vertex is written
+			glm::vec3 boundsMin, boundsMax;
+			positionBounds(mesh, boundsMin, boundsMax);
+			mesh::PackedVertex* packedData = result.mapPackedVertices(boundsMin, boundsMax);
+			if (packedData)
+			{
+				fillPackedVertices(mesh, result.positionScale, result.positionOffset, packedData);
+				filled = true;
+			}
+		}
+		else
+		{
+			mesh::Vertex* vertexData = result.mapVertices();
+			if (vertexData)
+			{
+				fillVertices(mesh, vertexData);
+				filled = true;
+			}
+		}
+		if (result.unmap() && filled)
+		{
+			loadStats.mappedMeshes++;
+		}
+		if (!lods.empty())
+		{
+			result.lods = lods;
+		}
+		loadStats.meshUploadMs += profiler::elapsedMs(start);
+
+		return result;
 	}
 
 	std::vector<mesh::Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
@@ -207,30 +1187,46 @@ namespace model
 		{
 			aiString str;
 			mat->GetTexture(type, i, &str);
-			
-			bool skip = false;
-			for (size_t j = 0; j < textures_loaded.size(); j++)
-			{
-				if (std::strcmp(textures_loaded.at(j).path.data(), str.C_Str()) == 0)
-				{
-					textures.push_back(textures_loaded.at(j));
-					skip = true;
-					break;
-				}
-			}
-
-			if (!skip)
-			{
-				mesh::Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), directory);
-				texture.type = typeName;
-				texture.path = std::string(str.C_Str());
-				textures.push_back(texture);
-			}
-
+			// Uploaded by uploadTextures once every image is decoded
+			mesh::Texture texture;
+			texture.type = typeName;
+			texture.path = std::string(str.C_Str());
+			textures.push_back(texture);
 		}
 		return textures;
 	}
 
+	mesh::Texture Model::loadTexture(const std::string& relativePath, const std::string& typeName)
+	{
+		mesh::Texture texture;
+		texture.type = typeName;
+		texture.path = relativePath;
 
-}
\ No newline at end of file
+		// Images already uploaded by any loader are shared through the cache
+		std::string filename = directory + '/' + texture.path;
+		if (textures::cache().contains(textures::TextureCache::key(filename)))
+		{
+			textures::Layer layer = textures::cache().acquire(filename);
+			texture.array = layer.array;
+			texture.layer = layer.layer;
+			return texture;
+		}
+
+		// Waits for the worker that decodes this image
+		queueDecode(filename);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		const textures::Image& image = decoding[filename].get();
+		loadStats.decodeWaitMs += profiler::elapsedMs(start);
+
+		// Uploads on the render thread
+		glstats::ScopedCaller caller{ "TextureFromFile" };
+		start = std::chrono::steady_clock::now();
+		textures::Layer layer = textures::cache().acquire(image);
+		texture.array = layer.array;
+		texture.layer = layer.layer;
+		loadStats.textureUploadMs += profiler::elapsedMs(start);
+		loadStats.textures++;
+
+		return texture;
+	}
+}
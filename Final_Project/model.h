@@ -1,6 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
 #include <vector>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
@@ -9,29 +14,190 @@
 
 #include "shaders.h"
 #include "mesh.h"
+#include "meshcache.h"
+#include "meshopt.h"
+#include "glstate.h"
+#include "profiler.h"
+#include "quantize.h"
+#include "renderqueue.h"
+#include "simplify.h"
+#include "textures.h"
+#include "texturearrays.h"
+#include "workers.h"
 
 namespace model
 {
+	// Time spent in each stage of loading a model, in milliseconds
+	struct LoadStats
+	{
+		double readFileMs;      // Assimp ReadFile
+		double postProcessMs;   // Assimp post processing added by the import preset
+		double optimizeMs;      // meshopt vertex cache, overdraw and vertex fetch ordering
+		double lodMs;           // simplify::buildLods
+		double processMs;       // processNode / processMesh conversion
+		double materialsMs;     // uploadTextures, includes waiting for decode and upload
+		double decodeMs;        // stbi_load, mipmaps and compression on the worker threads, or reading their cache, summed over images
+		double decodeWaitMs;    // render thread waiting for decoded images
+		double textureUploadMs; // glTexImage2D or glCompressedTexImage2D for every mip level
+		double meshUploadMs;    // Mesh::setup buffer uploads, with zeroCopy also the vertex conversion
+		double totalMs;
+		size_t meshes, textures;
+		size_t mappedMeshes;    // meshes Assimp converted straight into mapped buffers
+		bool fromCache;         // meshes came from the binary mesh cache, readFileMs is the mapping
+		LoadStats() : readFileMs{ 0.0 }, postProcessMs{ 0.0 }, optimizeMs{ 0.0 }, lodMs{ 0.0 }, processMs{ 0.0 }, materialsMs{ 0.0 }, decodeMs{ 0.0 }, decodeWaitMs{ 0.0 },
+			textureUploadMs{ 0.0 }, meshUploadMs{ 0.0 }, totalMs{ 0.0 }, meshes{ 0 }, textures{ 0 }, mappedMeshes{ 0 }, fromCache{ false } {}
+	};
+
+	// How much work Assimp does on import, trading import time against render time
+	enum class ImportPreset
+	{
+		FastLoad,        // triangulate only, every OBJ face corner stays its own vertex
+		OptimizedRender, // weld vertices, merge meshes and nodes, reorder triangles for the vertex cache
+		MaxQuality       // optimized render plus smooth normals and cleanup of degenerate data
+	};
+
+	// Assimp post processing flags for a preset, part of the mesh cache key
+	unsigned int importFlags(ImportPreset preset);
+	const char* presetName(ImportPreset preset);
+	// Accepts the names returned by presetName, e.g. "fast-load"
+	bool parsePreset(const std::string& name, ImportPreset& preset);
+
+	// Settings that change how a model is imported
+	struct LoadOptions
+	{
+		bool useMeshCache; // read and write <file>.meshcache next to the model
+		bool zeroCopy;     // keep no CPU copy, vertices are converted, and packed, straight into mapped GL buffers
+		bool async;        // import on the worker pool, the constructor returns right away
+		ImportPreset preset;
+		bool optimize;     // reorder triangles and vertices with meshopt before upload
+		bool lods;         // build simplified levels of detail for every mesh
+		mesh::VertexFormat vertexFormat; // layout on the GPU, the mesh cache always stores float vertices
+		bool compressTextures; // block compress textures and cache them in <image>.ktx, when the driver supports it
+		LoadOptions() : useMeshCache{ true }, zeroCopy{ true }, async{ false }, preset{ ImportPreset::OptimizedRender },
+			optimize{ true }, lods{ true }, vertexFormat{ mesh::VertexFormat::Packed }, compressTextures{ true } {}
+	};
+
+	// Progress of a model load. Synchronous loads are Ready or Failed
+	// once constructed, asynchronous ones advance through update().
+	enum class LoadState
+	{
+		Loading,   // importing on a worker thread, nothing is drawn
+		Uploading, // meshes are on the GPU, waiting for textures, a bounding box is drawn
+		Ready,
+		Failed
+	};
+
+	// CPU side result of an asynchronous import, defined in model.cpp
+	struct StagedModel;
+
+	// Largest on screen error, in pixels, a level of detail may have
+	const float LOD_PIXEL_ERROR = 1.0f;
+	// A coarser level is only picked once its error drops below this fraction
+	// of LOD_PIXEL_ERROR, so levels don't flicker at the switching distance
+	const float LOD_HYSTERESIS = 0.75f;
+
 	class Model
 	{
 	public:
 		glm::mat4 model;
-		std::vector<mesh::Texture> textures_loaded;
-		Model(const char* path) {
+		LoadStats loadStats;
+		LoadState state;
+		Model(const char* path, LoadOptions uOptions = LoadOptions()) {
 			this->model = glm::mat4(1.0f);
-			loadModel(path);
+			this->options = uOptions;
+			this->state = LoadState::Loading;
+			this->placeholderVAO = 0;
+			this->cacheWriter = NULL;
+			this->boundsMin = glm::vec3(0.0f);
+			this->boundsMax = glm::vec3(0.0f);
+			this->instances.push_back(glm::mat4(1.0f));
+			this->instancesChanged = true;
+			if (options.async)
+			{
+				loadAsync(path);
+			}
+			else
+			{
+				loadModel(path);
+			}
 		}
+		// Returns the meshes' buffer ranges to the heap and their textures to the cache
+		~Model();
 		void rotate(GLfloat degrees, GLchar axis);
 		void scale(GLfloat x, GLfloat y, GLfloat z);
 		void translate(GLfloat x, GLfloat y, GLfloat z);
-		void draw(shaders::Shader shader);
+		// Copies of the model, each placed at its transform times model. A
+		// new model has one copy at the identity. Each mesh draws every copy
+		// with one instanced draw per level of detail in use.
+		void addInstance(const glm::mat4& transform);
+		void setInstance(size_t index, const glm::mat4& transform);
+		void clearInstances();
+		size_t instanceCount() { return instances.size(); }
+		void draw(shaders::Shader& shader);
+		// Picks each mesh's level of detail before drawing. pixelsPerUnit is
+		// the screen size, in pixels, of one unit at distance one from the camera.
+		void draw(shaders::Shader& shader, const glm::vec3& cameraPos, float pixelsPerUnit);
+		// Like draw, but queues the meshes as opaque items sorted by the
+		// distance to the nearest copy's center. Placeholders still draw right
+		// away, returns the number of draw calls that made.
+		size_t submit(renderqueue::Queue& queue, shaders::Shader& shader, const glm::vec3& cameraPos, float pixelsPerUnit);
+		size_t meshCount() { return meshes.size(); }
+		bool ready() { return state == LoadState::Ready; }
+		// Moves an asynchronous load forward without blocking, uploading
+		// whatever the workers have finished. Runs on the render thread, draw calls it.
+		void update();
+		// Blocks until an asynchronous load has finished
+		void wait();
 	private:
 		std::vector<mesh::Mesh> meshes;
 		std::string directory;
+		// Path the model was loaded from, its GPU memory is reported under it
+		std::string source;
+		LoadOptions options;
+		// Images being decoded on the worker pool, keyed by file path
+		std::map<std::string, std::shared_future<textures::Image>> decoding;
+		// Set while an Assimp import writes a new mesh cache
+		meshcache::Writer* cacheWriter;
+		// Float vertices of the mesh being written to it
+		std::vector<mesh::Vertex> cacheVertices;
+		// Model space bounds of every mesh, used to pick levels of detail
+		glm::vec3 boundsMin, boundsMax;
+		// Instance transforms, and the matrices last uploaded for them
+		std::vector<glm::mat4> instances;
+		std::vector<glm::mat4> transforms;
+		// Transforms in instance buffer order, copies needing the most detail first
+		std::vector<uint32_t> instanceOrder;
+		// Level each copy of each mesh drew with last, by mesh then instance
+		std::vector<std::vector<size_t>> instanceLods;
+		mesh::InstanceBuffer instanceBuffer;
+		glm::mat4 uploadedModel;
+		bool instancesChanged;
+		// Asynchronous loading
+		std::chrono::steady_clock::time_point loadStart;
+		std::future<std::shared_ptr<StagedModel>> staging;
+		GLuint placeholderVAO, placeholderVBO, placeholderEBO;
 	
 		void loadModel(std::string path);
+		void loadAsync(std::string path);
+		void finishStaging(const StagedModel& staged);
+		bool uploadTextures(bool block);
+		void finishLoad();
+		void createPlaceholder(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+		bool drawPlaceholder(shaders::Shader& shader);
+		void deletePlaceholder();
+		// Uploads the transforms when the instances or model changed
+		void updateInstances();
+		void uploadInstances();
+		// Picks each copy's level of detail for every mesh and sorts the
+		// instance buffer so each level is one range of it. Returns the
+		// distance from the camera to the nearest copy's center.
+		float selectLod(const glm::vec3& cameraPos, float pixelsPerUnit);
+		bool loadCached(const std::string& path, uint64_t key);
+		void queueDecode(const std::string& filename);
+		void decodeTextures(const aiScene* scene);
 		void processNode(aiNode* node, const aiScene* scene);
 		mesh::Mesh processMesh(aiMesh* mesh, const aiScene* scene);
 		std::vector<mesh::Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
+		mesh::Texture loadTexture(const std::string& relativePath, const std::string& typeName);
 	};
 }
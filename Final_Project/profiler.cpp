@@ -0,0 +1,190 @@
+/*
+* profiler.cpp
+* This file contains implementations for the CPU and GPU frame profiler
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "profiler.h"
+#include <fstream>
+#include <iostream>
+
+namespace profiler
+{
+	Profiler frameProfiler{ 600 };
+
+	Profiler::Profiler(size_t uCapacity)
+	{
+		enabled = false;
+		capacity = uCapacity;
+		head = 0;
+		frameNumber = 0;
+		currentSlot = 0;
+		inFrame = false;
+		inPass = false;
+	}
+
+	void Profiler::createQueries()
+	{
+		// Query objects need a context, so they are created on first use
+		pending.resize(QUERY_LATENCY + 1);
+		for (size_t i = 0; i < pending.size(); i++)
+		{
+			pending.at(i).queries.resize(MAX_PASSES);
+			glGenQueries(MAX_PASSES, &pending.at(i).queries[0]);
+		}
+	}
+
+	void Profiler::collect(PendingFrame& slot)
+	{
+		if (slot.sample.passes.empty())
+		{
+			return;
+		}
+
+		// Reads GPU time of each pass without blocking
+		for (size_t i = 0; i < slot.sample.passes.size(); i++)
+		{
+			GLuint available = 0;
+			glGetQueryObjectuiv(slot.queries.at(i), GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available)
+			{
+				GLuint64 elapsed = 0;
+				glGetQueryObjectui64v(slot.queries.at(i), GL_QUERY_RESULT, &elapsed);
+				slot.sample.passes.at(i).gpuMs = elapsed / 1000000.0;
+			}
+		}
+
+		// Moves the finished frame into the ring buffer
+		if (history.size() < capacity)
+		{
+			history.push_back(slot.sample);
+		}
+		else
+		{
+			history.at(head) = slot.sample;
+		}
+		head = (head + 1) % capacity;
+		slot.sample.passes.clear();
+	}
+
+	void Profiler::beginFrame()
+	{
+		if (!enabled)
+		{
+			return;
+		}
+		if (pending.empty())
+		{
+			createQueries();
+		}
+
+		// Reuses the oldest slot, its queries were issued QUERY_LATENCY frames ago
+		currentSlot = frameNumber % pending.size();
+		PendingFrame& slot = pending.at(currentSlot);
+		collect(slot);
+		slot.sample.frame = frameNumber;
+		inFrame = true;
+	}
+
+	void Profiler::endFrame()
+	{
+		if (!inFrame)
+		{
+			return;
+		}
+		inFrame = false;
+		frameNumber++;
+	}
+
+	bool Profiler::beginPass(const char* name)
+	{
+		if (!inFrame || inPass)
+		{
+			return false;
+		}
+		PendingFrame& slot = pending.at(currentSlot);
+		if (slot.sample.passes.size() >= MAX_PASSES)
+		{
+			return false;
+		}
+
+		PassSample pass;
+		pass.name = name;
+		pass.cpuMs = 0.0;
+		pass.gpuMs = -1.0;
+		slot.sample.passes.push_back(pass);
+
+		glBeginQuery(GL_TIME_ELAPSED, slot.queries.at(slot.sample.passes.size() - 1));
+		passStart = std::chrono::steady_clock::now();
+		inPass = true;
+		return true;
+	}
+
+	void Profiler::endPass()
+	{
+		if (!inPass)
+		{
+			return;
+		}
+		PendingFrame& slot = pending.at(currentSlot);
+		std::chrono::steady_clock::time_point passEnd = std::chrono::steady_clock::now();
+		glEndQuery(GL_TIME_ELAPSED);
+		slot.sample.passes.back().cpuMs =
+			std::chrono::duration<double, std::milli>(passEnd - passStart).count();
+		inPass = false;
+	}
+
+	bool Profiler::dumpCSV(const std::string& path)
+	{
+		std::ofstream file{ path };
+		if (!file)
+		{
+			std::cout << "ERROR: failed to open profile output " << path << std::endl;
+			return false;
+		}
+
+		// Waits for the frames still in flight so they are included
+		glFinish();
+		for (size_t i = 0; i < pending.size(); i++)
+		{
+			collect(pending.at((frameNumber + i) % pending.size()));
+		}
+
+		file << "frame,pass,cpu_ms,gpu_ms\n";
+		// Oldest frame first
+		size_t start = (history.size() < capacity) ? 0 : head;
+		for (size_t i = 0; i < history.size(); i++)
+		{
+			const FrameSample& sample = history.at((start + i) % history.size());
+			for (size_t j = 0; j < sample.passes.size(); j++)
+			{
+				const PassSample& pass = sample.passes.at(j);
+				file << sample.frame << ',' << pass.name << ','
+					<< pass.cpuMs << ',' << pass.gpuMs << '\n';
+			}
+		}
+		return true;
+	}
+
+	// ScopedPass class
+	ScopedPass::ScopedPass(Profiler& uProfiler, const char* name) : owner{ uProfiler }
+	{
+		active = owner.enabled && owner.beginPass(name);
+	}
+
+	ScopedPass::~ScopedPass()
+	{
+		if (active)
+		{
+			owner.endPass();
+		}
+	}
+}
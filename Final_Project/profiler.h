@@ -0,0 +1,97 @@
+/*
+* profiler.h
+* This file contains declarations for the CPU and GPU frame profiler
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace profiler
+{
+	// Most passes that are timed in a single frame
+	const size_t MAX_PASSES = 32;
+	// Frames between issuing a GPU query and reading its result,
+	// so reading results never waits on the GPU
+	const size_t QUERY_LATENCY = 3;
+
+	struct PassSample
+	{
+		std::string name;
+		double cpuMs;
+		double gpuMs; // negative if the GPU result was not available
+	};
+
+	struct FrameSample
+	{
+		unsigned long frame;
+		std::vector<PassSample> passes;
+		FrameSample() : frame{ 0 } {}
+	};
+
+	class Profiler
+	{
+	public:
+		bool enabled;
+		Profiler(size_t uCapacity);
+		void beginFrame();
+		void endFrame();
+		// Returns false when no pass started, outside a frame, inside another
+		// pass or past MAX_PASSES. Only a started pass may be ended.
+		bool beginPass(const char* name);
+		void endPass();
+		// Writes every frame in the ring buffer as frame,pass,cpu_ms,gpu_ms rows
+		bool dumpCSV(const std::string& path);
+
+	private:
+		// Frame that is waiting for its GPU queries
+		struct PendingFrame
+		{
+			FrameSample sample;
+			std::vector<GLuint> queries;
+		};
+
+		size_t capacity;
+		std::vector<FrameSample> history; // ring buffer of completed frames
+		size_t head;
+		std::vector<PendingFrame> pending; // one slot per frame in flight
+		unsigned long frameNumber;
+		size_t currentSlot;
+		std::chrono::steady_clock::time_point passStart;
+		bool inFrame, inPass;
+
+		void createQueries();
+		void collect(PendingFrame& slot);
+	};
+
+	// Times a block of code as one pass, does nothing if the profiler is disabled
+	class ScopedPass
+	{
+	public:
+		ScopedPass(Profiler& uProfiler, const char* name);
+		~ScopedPass();
+	private:
+		Profiler& owner;
+		bool active; // this pass started, nested ones don't
+	};
+
+	// Milliseconds since start
+	inline double elapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Profiler shared by the render loop
+	extern Profiler frameProfiler;
+}
@@ -0,0 +1,96 @@
+/*
+* quantize.cpp
+* This file contains implementations for packing vertices into compact formats
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+* Octahedral normals from Cigolle et al., "A Survey of Efficient
+* Representations for Independent Unit Vectors", 2014.
+*/
+
+#include "quantize.h"
+#include <glm/gtc/packing.hpp>
+
+namespace quantize
+{
+	static_assert(sizeof(mesh::PackedVertex) == 16, "mesh::PackedVertex must be half the size of mesh::Vertex");
+
+	// Helper functions
+
+	// Like sign, but never zero, so folded normals on an axis stay on the right side
+	glm::vec2 signNotZero(const glm::vec2& v)
+	{
+		return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	glm::vec2 encodeOctahedral(const glm::vec3& normal)
+	{
+		float length = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+		if (length == 0.0f)
+		{
+			return glm::vec2(0.0f);
+		}
+		glm::vec3 n = normal / length;
+		glm::vec2 encoded = glm::vec2(n.x, n.y);
+		if (n.z < 0.0f)
+		{
+			// Folds the lower half of the octahedron over the diagonals
+			encoded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signNotZero(encoded);
+		}
+		return encoded;
+	}
+
+	glm::vec3 decodeOctahedral(const glm::vec2& encoded)
+	{
+		glm::vec3 n = glm::vec3(encoded.x, encoded.y, 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y));
+		float t = glm::max(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+		return glm::normalize(n);
+	}
+
+	mesh::PackedVertex packVertex(const mesh::Vertex& vertex, const glm::vec3& scale, const glm::vec3& offset)
+	{
+		mesh::PackedVertex result;
+		for (size_t a = 0; a < 3; a++)
+		{
+			// Flat axes have a zero scale, every vertex decodes to the offset
+			float fraction = scale[a] > 0.0f ? (vertex.position[a] - offset[a]) / scale[a] : 0.0f;
+			result.position[a] = glm::packUnorm1x16(fraction);
+		}
+		result.position[3] = 0;
+
+		glm::vec2 normal = encodeOctahedral(vertex.normal);
+		result.normal[0] = (GLshort)glm::packSnorm1x16(normal.x);
+		result.normal[1] = (GLshort)glm::packSnorm1x16(normal.y);
+
+		result.texture[0] = glm::packHalf1x16(vertex.texture.x);
+		result.texture[1] = glm::packHalf1x16(vertex.texture.y);
+		return result;
+	}
+
+	void packVertices(const mesh::Vertex* vertices, size_t vertexCount, mesh::PackedVertex* packed,
+		glm::vec3& scale, glm::vec3& offset)
+	{
+		glm::vec3 boundsMin = glm::vec3(0.0f);
+		glm::vec3 boundsMax = glm::vec3(0.0f);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			boundsMin = i == 0 ? vertices[i].position : glm::min(boundsMin, vertices[i].position);
+			boundsMax = i == 0 ? vertices[i].position : glm::max(boundsMax, vertices[i].position);
+		}
+		scale = boundsMax - boundsMin;
+		offset = boundsMin;
+
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			packed[i] = packVertex(vertices[i], scale, offset);
+		}
+	}
+}
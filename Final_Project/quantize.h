@@ -0,0 +1,37 @@
+/*
+* quantize.h
+* This file contains declarations for packing vertices into compact formats
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+* Octahedral normals from Cigolle et al., "A Survey of Efficient
+* Representations for Independent Unit Vectors", 2014.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "mesh.h"
+
+// Converts mesh::Vertex into mesh::PackedVertex. The vertex shaders undo
+// the packing, see decodeOctahedral and positionScale in vertex_shader.txt.
+
+namespace quantize
+{
+	// Maps a unit vector onto the [-1, 1] square. Zero vectors map to +z.
+	glm::vec2 encodeOctahedral(const glm::vec3& normal);
+	glm::vec3 decodeOctahedral(const glm::vec2& encoded);
+
+	// Packs one vertex whose position lies in the box offset to offset + scale
+	mesh::PackedVertex packVertex(const mesh::Vertex& vertex, const glm::vec3& scale, const glm::vec3& offset);
+	// Packs positions relative to the vertices' bounding box. The shader gets
+	// the original position back as packed * scale + offset.
+	void packVertices(const mesh::Vertex* vertices, size_t vertexCount, mesh::PackedVertex* packed,
+		glm::vec3& scale, glm::vec3& offset);
+}
@@ -0,0 +1,156 @@
+/*
+* renderqueue.cpp
+* This file contains definitions for sorting draws before they are issued
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "renderqueue.h"
+#include <cstring>
+#include <utility>
+
+namespace renderqueue
+{
+	// Helper functions
+	uint32_t depthBits(float distance)
+	{
+		// Negative distances and NaN would sort above everything
+		if (!(distance > 0.0f))
+		{
+			return 0;
+		}
+		uint32_t bits;
+		std::memcpy(&bits, &distance, sizeof(bits));
+		return bits;
+	}
+
+	uint64_t makeKey(Pass pass, GLuint program, GLuint textureArray, GLuint vertexArray, float distance)
+	{
+		uint64_t state = ((uint64_t)(program & 0xFF) << 22)
+			| ((uint64_t)(textureArray & 0xFFF) << 10)
+			| (uint64_t)(vertexArray & 0x3FF);
+		uint64_t depth = depthBits(distance);
+		if (pass == Pass::Transparent)
+		{
+			// Farthest first, state only breaks ties
+			return ((uint64_t)pass << 62) | ((uint64_t)(~(uint32_t)depth) << 30) | state;
+		}
+		return ((uint64_t)pass << 62) | (state << 32) | depth;
+	}
+
+	void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+	{
+		const size_t count = entries.size();
+		scratch.resize(count);
+
+		// Counts every byte of every key in one sweep
+		std::vector<size_t> histograms(8 * 256, 0);
+		for (size_t i = 0; i < count; i++)
+		{
+			uint64_t key = entries[i].key;
+			for (size_t byte = 0; byte < 8; byte++)
+			{
+				histograms[byte * 256 + ((key >> (byte * 8)) & 0xFF)]++;
+			}
+		}
+
+		std::vector<SortEntry>* from = &entries;
+		std::vector<SortEntry>* to = &scratch;
+		for (size_t byte = 0; byte < 8; byte++)
+		{
+			size_t* histogram = &histograms[byte * 256];
+			if (count == 0 || histogram[((*from)[0].key >> (byte * 8)) & 0xFF] == count)
+			{
+				continue;
+			}
+
+			// Turns the counts into each bucket's first slot
+			size_t offset = 0;
+			for (size_t bucket = 0; bucket < 256; bucket++)
+			{
+				size_t bucketCount = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketCount;
+			}
+			for (size_t i = 0; i < count; i++)
+			{
+				const SortEntry& entry = (*from)[i];
+				(*to)[histogram[(entry.key >> (byte * 8)) & 0xFF]++] = entry;
+			}
+			std::swap(from, to);
+		}
+
+		if (from != &entries)
+		{
+			entries.swap(scratch);
+		}
+	}
+
+	// Queue class
+	void Queue::submit(Pass pass, shaders::Shader& shader, const mesh::InstanceBuffer* instances, mesh::Mesh* mesh, float distance)
+	{
+		GLuint textureArray = mesh->textures.empty() ? 0 : mesh->textures[0].array;
+		Item item{ makeKey(pass, shader.ID, textureArray, mesh->vertexArray(), distance), &shader, instances, mesh, NULL };
+		items.push_back(item);
+	}
+
+	void Queue::submit(Pass pass, mesh::TriangleMesh* triangleMesh, float distance)
+	{
+		Item item{ makeKey(pass, triangleMesh->shaderProgram.ID, triangleMesh->texture.array,
+			triangleMesh->allocation->VAO, distance), &triangleMesh->shaderProgram, &triangleMesh->instances, NULL, triangleMesh };
+		items.push_back(item);
+	}
+
+	void Queue::sort()
+	{
+		entries.resize(items.size());
+		for (size_t i = 0; i < items.size(); i++)
+		{
+			entries[i].key = items[i].key;
+			entries[i].item = (uint32_t)i;
+		}
+		radixSort(entries, scratch);
+	}
+
+	size_t Queue::dispatch()
+	{
+		glstats::ScopedCaller caller{ "Queue::dispatch" };
+		// Sorts whatever was submitted since the last sort
+		if (entries.size() != items.size())
+		{
+			sort();
+		}
+
+		// Programs are only made current when they change
+		GLuint program = 0;
+		size_t drawn = 0;
+		for (std::vector<SortEntry>::iterator it = entries.begin(); it != entries.end(); ++it)
+		{
+			Item& item = items[it->item];
+			if (item.triangleMesh != NULL)
+			{
+				item.triangleMesh->draw();
+				program = item.triangleMesh->shaderProgram.ID;
+				drawn++;
+				continue;
+			}
+			if (item.shader->ID != program)
+			{
+				item.shader->use();
+				program = item.shader->ID;
+			}
+			drawn += item.mesh->issue(*item.shader, *item.instances);
+		}
+
+		items.clear();
+		entries.clear();
+		return drawn;
+	}
+}
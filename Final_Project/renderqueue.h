@@ -0,0 +1,81 @@
+/*
+* renderqueue.h
+* This file contains declarations for sorting draws before they are issued
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "shaders.h"
+#include "mesh.h"
+
+// Objects don't draw themselves in the order the scene lists them. They
+// submit one item per mesh with a 64 bit key, the queue radix sorts the
+// keys once per frame and dispatches in key order. Opaque keys hold,
+// from the top bit down:
+//   pass 2 | program 8 | texture array 12 | VAO 10 | depth 32
+// so draws sharing a program, array and VAO follow each other and, within
+// them, near meshes draw first and hide the fragments of far ones.
+// Transparent keys put the depth, inverted, right below the pass so they
+// draw back to front whatever their state. Ids wider than their field
+// only cost grouping, dispatch compares the real ones.
+
+namespace renderqueue
+{
+	enum class Pass
+	{
+		Opaque,
+		Transparent
+	};
+
+	// Distance from the camera as sortable bits, positive floats order like their bits
+	uint32_t depthBits(float distance);
+	uint64_t makeKey(Pass pass, GLuint program, GLuint textureArray, GLuint vertexArray, float distance);
+
+	struct Item
+	{
+		uint64_t key;
+		shaders::Shader* shader;
+		const mesh::InstanceBuffer* instances; // owned by the submitter
+		mesh::Mesh* mesh;
+		mesh::TriangleMesh* triangleMesh;      // draws with its own program and instance instead
+	};
+
+	// LSD radix sort of (key, item) pairs, 8 bits a pass. Passes where every
+	// key has the same byte are skipped. Stable, so equal keys keep their
+	// submission order. scratch is resized to match.
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t item;
+	};
+	void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+	class Queue
+	{
+	public:
+		// Items point at the submitter's meshes and instances, which must
+		// stay alive until dispatch
+		void submit(Pass pass, shaders::Shader& shader, const mesh::InstanceBuffer* instances, mesh::Mesh* mesh, float distance);
+		void submit(Pass pass, mesh::TriangleMesh* triangleMesh, float distance);
+		void sort();
+		// Draws every item in key order and empties the queue, returns the
+		// number of draw calls issued. Items with nothing to draw don't count.
+		size_t dispatch();
+		size_t size() { return items.size(); }
+	private:
+		std::vector<Item> items;
+		std::vector<SortEntry> entries, scratch;
+	};
+}
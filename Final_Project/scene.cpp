@@ -0,0 +1,201 @@
+/*
+* scene.cpp
+* This file contains implementations for the default scene
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "scene.h"
+
+namespace scene
+{
+	// Helper functions
+	std::vector<GLfloat> lightVertices()
+	{
+		return std::vector<GLfloat>{
+			// POSITION              // Normals        // Texture
+			-0.25f,  0.25f,  0.25f,  0.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 0 - Top left front
+			 0.25f,  0.25f,  0.25f,  0.0f, 0.0f, 0.0f, 1.0f, 1.0f, // 1 - Top right front
+			-0.25f, -0.25f,  0.25f,  0.0f, 0.0f, 0.0f, 0.0f, 0.0f, // 2 - Bottom left front
+			 0.25f, -0.25f,  0.25f,  0.0f, 0.0f, 0.0f, 1.0f, 0.0f, // 3 - Bottom right front
+
+			-0.25f,  0.25f, -0.25f,  0.0f, 0.0f, 0.0f, 3.0f, 1.0f, // 4 - Top left back
+			 0.25f,  0.25f, -0.25f,  0.0f, 0.0f, 0.0f, 2.0f, 1.0f, // 5 - Top right back
+			-0.25f, -0.25f, -0.25f,  0.0f, 0.0f, 0.0f, 3.0f, 0.0f, // 6 - Bottom left back
+			 0.25f, -0.25f, -0.25f,  0.0f, 0.0f, 0.0f, 2.0f, 0.0f, // 7 - Bottom right back
+
+			// Top
+			-0.25f,  0.25f,  0.25f,  0.0f, 0.0f, 0.0f, 0.0f, 0.0f, // 8 - Top left front
+			 0.25f,  0.25f,  0.25f,  0.0f, 0.0f, 0.0f, 1.0f, 0.0f, // 9 - Top right front
+			-0.25f,  0.25f, -0.25f,  0.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 10 - Top left back
+			 0.25f,  0.25f, -0.25f,  0.0f, 0.0f, 0.0f, 1.0f, 1.0f, // 11 - Top right back
+
+			// Bottom
+			-0.25f, -0.25f,  0.25f,  0.0f, 0.0f, 0.0f, 0.0f, 1.0f, // 12 - Bottom left front
+			 0.25f, -0.25f,  0.25f,  0.0f, 0.0f, 0.0f, 1.0f, 1.0f, // 13 - Bottom right front
+			-0.25f, -0.25f, -0.25f,  0.0f, 0.0f, 0.0f, 0.0f, 0.0f, // 14 - Bottom left back
+			 0.25f, -0.25f, -0.25f,  0.0f, 0.0f, 0.0f, 1.0f, 0.0f, // 15 - Bottom right back
+		};
+	}
+
+	std::vector<GLuint> lightIndices()
+	{
+		return std::vector<GLuint>{
+			0, 1, 2,    // triangle 1 front
+			1, 2, 3,    // triangle 2 front
+			4, 5, 6,    // triangle 1 back
+			5, 6, 7,    // triangle 2 back
+			8, 9, 10,   // triangle 1 top
+			9, 10, 11,  // triangle 2 top
+			12, 13, 14, // triangle 1 bottom
+			13, 14, 15, // triangle 2 bottom
+			0, 2, 6,    // triangle 1 left
+			0, 4, 6,    // triangle 2 left
+			1, 3, 5, // triangle 1 right
+			3, 5, 7  // triangle 2 right
+		};
+	}
+
+	std::vector<GLfloat> tableVertices()
+	{
+		return std::vector<GLfloat>{
+			// Position            // Normals        // Texture
+			-25.0f, 0.0f, -25.0f,  0.0f, 1.0f, 0.0f, 0.0f, 12.0f, // 0 - back left
+			 25.0f, 0.0f, -25.0f,  0.0f, 1.0f, 0.0f, 12.0f, 12.0f, // 1 - back right
+			-25.0f, 0.0f,  25.0f,  0.0f, 1.0f, 0.0f, 0.0f, 0.0f, // 2 - front left
+			 25.0f, 0.0f,  25.0f,  0.0f, 1.0f, 0.0f, 12.0f, 0.0f  // 3 - front right
+		};
+	}
+
+	std::vector<GLuint> tableIndices()
+	{
+		return std::vector<GLuint>{
+			0, 2, 3,
+			0, 1, 3
+		};
+	}
+
+	// Scene class
+	Scene::Scene(GLfloat aspect, model::LoadOptions modelOptions) :
+		// -------------------- SHADER PROGRAMS --------------------
+		// Light source shader program so that light source will not be effected
+		// by ambient light, and object shader program that is effected by ambient light
+		lightSourceShader{ "shader_source/light_source_vertex_shader.txt",
+			"shader_source/light_source_fragment_shader.txt" },
+		objectShader{ "shader_source/vertex_shader.txt",
+			"shader_source/fragment_shader.txt" },
+		lightPos{ 20.0f, 20.0f, 20.0f },
+		projection{ glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f) },
+		// -------------------- SCENE OBJECTS --------------------
+		light{ lightVertices(), lightIndices(), lightSourceShader,
+			"textures/light_01.jpg", glm::vec4(0.5f, 0.5f, 0.5f, 1.0f), 1.0f },
+		table{ tableVertices(), tableIndices(), objectShader,
+			"textures/wood_table_01.jpg", glm::vec4(0.25f, 0.25f, 0.25f, 1.0f), 1.0f },
+		book{ "models/book/book.obj", modelOptions },
+		headphones{ "models/headphones/headphones.obj", modelOptions },
+		pen{ "models/pen/pen.obj", modelOptions },
+		cup{ "models/cup/cup.obj", modelOptions }
+	{
+		// -------------------- LIGHTING --------------------
+		frame.light.position = lightPos;
+		frame.light.padding = 0.0f;
+		frame.light.ambient = glm::vec4(0.1f, 0.1f, 0.1f, 1.0f);
+		frame.light.diffuse = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		frame.light.specular = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+
+		GLfloat ambientStrength = 1.0f;
+
+		// Sets ambient strength of light source
+		lightSourceShader.use();
+		lightSourceShader.set(lightSourceShader.location("ambientStrength"), ambientStrength);
+
+		// -------------------- Projection --------------------
+		// Shared by both shaders through the frame uniforms
+		frame.projection = projection;
+		frame.padding = 0.0f;
+
+		// -------------------- TRANSFORMS --------------------
+		light.translate(lightPos.x, lightPos.y, lightPos.z);
+		light.scale(5.0f, 5.0f, 5.0f);
+
+		book.translate(0.0f, 0.0f, 10.0f);
+		book.rotate(-90.0f, 'y');
+
+		headphones.translate(5.0f, 0.5f, 6.0f);
+		headphones.rotate(225.0f, 'y');
+
+		pen.translate(-2.0f, 0.25f, 11.0f);
+
+		cup.translate(-5.0f, 0.1f, 5.0f);
+		cup.rotate(180.0f, 'y');
+	}
+
+	Scene::~Scene()
+	{
+		frameUniforms.release();
+	}
+
+	void Scene::wait()
+	{
+		book.wait();
+		headphones.wait();
+		pen.wait();
+		cup.wait();
+	}
+
+	size_t Scene::draw(const glm::mat4& view, const glm::vec3& cameraPos)
+	{
+		glstats::ScopedCaller caller{ "Scene::draw" };
+		{
+			profiler::ScopedPass pass{ profiler::frameProfiler, "clear" };
+			// Enable Z-depth testing to test which objects are covered by others
+			glstate::enable(GL_DEPTH_TEST);
+			// Accept the closer fragment
+			glstate::depthFunc(GL_LESS);
+
+			// Clears frame and Z buffers
+			glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+
+		{
+			profiler::ScopedPass pass{ profiler::frameProfiler, "uniforms" };
+			// Sends view information to every shader in one upload
+			frame.view = view;
+			frame.viewPos = cameraPos;
+			frameUniforms.update(frame);
+		}
+
+		// Screen size of one unit at distance one, models pick their levels of detail from it
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		float pixelsPerUnit = projection[1][1] * viewport[3] * 0.5f;
+
+		// Queues every mesh, then draws them grouped by state and front to back.
+		// Models still loading draw their placeholders while submitting.
+		size_t drawn = 0;
+		{
+			profiler::ScopedPass pass{ profiler::frameProfiler, "submit" };
+			queue.submit(renderqueue::Pass::Opaque, &light, glm::length(glm::vec3(light.model[3]) - cameraPos));
+			queue.submit(renderqueue::Pass::Opaque, &table, glm::length(glm::vec3(table.model[3]) - cameraPos));
+			drawn += book.submit(queue, objectShader, cameraPos, pixelsPerUnit);
+			drawn += headphones.submit(queue, objectShader, cameraPos, pixelsPerUnit);
+			drawn += pen.submit(queue, objectShader, cameraPos, pixelsPerUnit);
+			drawn += cup.submit(queue, objectShader, cameraPos, pixelsPerUnit);
+			queue.sort();
+		}
+		{
+			profiler::ScopedPass pass{ profiler::frameProfiler, "dispatch" };
+			drawn += queue.dispatch();
+		}
+
+		return drawn;
+	}
+}
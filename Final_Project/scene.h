@@ -0,0 +1,60 @@
+/*
+* scene.h
+* This file contains declarations for the default scene
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <vector>
+#include "shaders.h"
+#include "mesh.h"
+#include "model.h"
+#include "profiler.h"
+#include "renderqueue.h"
+
+namespace scene
+{
+	// Builds the desk scene (light cube, table, book, headphones, pen, cup)
+	// so it can be shared by the application and the benchmark
+	class Scene
+	{
+	public:
+		shaders::Shader lightSourceShader;
+		shaders::Shader objectShader;
+		glm::vec3 lightPos;
+		glm::mat4 projection;
+		// Camera and light, uploaded once per frame for both shaders
+		shaders::FrameUniforms frame;
+		shaders::FrameUniformBuffer frameUniforms;
+		mesh::TriangleMesh light;
+		mesh::TriangleMesh table;
+		model::Model book;
+		model::Model headphones;
+		model::Model pen;
+		model::Model cup;
+		// Every object submits here, draw sorts and dispatches it each frame
+		renderqueue::Queue queue;
+
+		// Models load with the given options, asynchronous ones appear once uploaded
+		Scene(GLfloat aspect, model::LoadOptions modelOptions = model::LoadOptions());
+		// Deletes the frame uniform buffer, the meshes and models free their own
+		~Scene();
+		// Blocks until every model has finished loading
+		void wait();
+		// Clears the bound framebuffer and draws every object,
+		// returns the number of draw calls issued
+		size_t draw(const glm::mat4& view, const glm::vec3& cameraPos);
+	};
+}
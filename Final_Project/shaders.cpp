@@ -13,9 +13,30 @@
 */
 
 #include "shaders.h"
+#include "glstate.h"
+#include "gpumem.h"
+#include <glm/gtc/type_ptr.hpp>
 
 namespace shaders
 {
+	// Names in the order of Uniform
+	const char* UNIFORM_NAMES[(int)Uniform::Count] = {
+		"positionScale",
+		"positionOffset",
+		"octahedralNormals",
+		"textureLayer",
+		"material.specular",
+		"material.shininess"
+	};
+
+	Shader::Shader() : ID{ 1000 }
+	{
+		for (int i = 0; i < (int)Uniform::Count; i++)
+		{
+			known[i] = -1;
+		}
+	}
+
 	Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
 	{
 		// --------------- VARIABLES ---------------
@@ -117,10 +138,126 @@ namespace shaders
 		glDeleteShader(fragmentShaderID);
 
 		ID = shaderProgram;
+		reflect();
 	}
 
 	void Shader::use()
 	{
-		glUseProgram(ID);
+		glstate::useProgram(ID);
+	}
+
+	void Shader::reflect()
+	{
+		// Reads the per-frame uniforms from the shared buffer
+		GLuint frameBlock = glGetUniformBlockIndex(ID, "Frame");
+		if (frameBlock != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(ID, frameBlock, FRAME_BINDING);
+		}
+
+		// Every active uniform, struct members are listed one by one, e.g. "light.position"
+		GLint count = 0;
+		GLint longest = 0;
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &longest);
+		std::string name(longest, '\0');
+		for (GLint i = 0; i < count; i++)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(ID, i, longest, &length, &size, &type, &name[0]);
+			std::string uniform = name.substr(0, length);
+			GLint uniformLocation = glGetUniformLocation(ID, uniform.c_str());
+			if (uniformLocation < 0)
+			{
+				continue; // uniforms in blocks have no location
+			}
+			uniforms[uniform] = uniformLocation;
+			// Arrays are listed as "name[0]", also accept just the name
+			size_t bracket = uniform.find("[0]");
+			if (bracket != std::string::npos && bracket + 3 == uniform.size())
+			{
+				uniforms[uniform.substr(0, bracket)] = uniformLocation;
+			}
+		}
+
+		for (int i = 0; i < (int)Uniform::Count; i++)
+		{
+			known[i] = location(UNIFORM_NAMES[i]);
+		}
+	}
+
+	GLint Shader::location(const std::string& name) const
+	{
+		std::unordered_map<std::string, GLint>::const_iterator found = uniforms.find(name);
+		return found == uniforms.end() ? -1 : found->second;
+	}
+
+	void Shader::set(GLint location, GLint value)
+	{
+		if (location >= 0)
+		{
+			glUniform1i(location, value);
+		}
+	}
+
+	void Shader::set(GLint location, GLfloat value)
+	{
+		if (location >= 0)
+		{
+			glUniform1f(location, value);
+		}
+	}
+
+	void Shader::set(GLint location, const glm::vec3& value)
+	{
+		if (location >= 0)
+		{
+			glUniform3fv(location, 1, glm::value_ptr(value));
+		}
+	}
+
+	void Shader::set(GLint location, const glm::vec4& value)
+	{
+		if (location >= 0)
+		{
+			glUniform4fv(location, 1, glm::value_ptr(value));
+		}
+	}
+
+	void Shader::set(GLint location, const glm::mat4& value)
+	{
+		if (location >= 0)
+		{
+			glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+		}
+	}
+
+	// FrameUniformBuffer class
+	FrameUniformBuffer::FrameUniformBuffer()
+	{
+		glGenBuffers(1, &ID);
+		glBindBuffer(GL_UNIFORM_BUFFER, ID);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, ID);
+		gpumem::trackBuffer(ID, gpumem::Kind::Uniform, sizeof(FrameUniforms));
+	}
+
+	void FrameUniformBuffer::update(const FrameUniforms& frame)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, ID);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+	}
+
+	void FrameUniformBuffer::release()
+	{
+		if (ID == 0)
+		{
+			return;
+		}
+		glDeleteBuffers(1, &ID);
+		gpumem::release(ID, gpumem::Kind::Uniform);
+		ID = 0;
 	}
 }
\ No newline at end of file
@@ -18,15 +18,94 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include <cstddef>
 
 namespace shaders
 {
+	// Uniform buffer binding of the Frame block, every program reads it from here
+	const GLuint FRAME_BINDING = 0;
+
+	// Mirrors the Light struct of the shaders under std140 rules: a vec3
+	// takes 16 bytes when a vec4 follows it
+	struct LightUniforms
+	{
+		glm::vec3 position;
+		float padding;
+		glm::vec4 ambient;
+		glm::vec4 diffuse;
+		glm::vec4 specular;
+	};
+
+	// Mirrors the std140 Frame block every shader declares
+	struct FrameUniforms
+	{
+		glm::mat4 projection;
+		glm::mat4 view;
+		glm::vec3 viewPos;
+		float padding;
+		LightUniforms light;
+	};
+
+	static_assert(offsetof(LightUniforms, ambient) == 16, "Light.ambient must be at std140 offset 16");
+	static_assert(sizeof(LightUniforms) == 64, "Light must be 64 bytes under std140");
+	static_assert(offsetof(FrameUniforms, view) == 64, "Frame.view must be at std140 offset 64");
+	static_assert(offsetof(FrameUniforms, viewPos) == 128, "Frame.viewPos must be at std140 offset 128");
+	static_assert(offsetof(FrameUniforms, light) == 144, "Frame.light must be at std140 offset 144");
+	static_assert(sizeof(FrameUniforms) == 208, "Frame must be 208 bytes under std140");
+
+	// Uniform buffer holding FrameUniforms, bound to FRAME_BINDING for as
+	// long as it exists. One upload per frame reaches every program.
+	class FrameUniformBuffer
+	{
+	public:
+		GLuint ID;
+		FrameUniformBuffer();
+		void update(const FrameUniforms& frame);
+		void release();
+	};
+
+	// Uniforms the meshes set on every draw. Their locations are looked up
+	// once at link time, so drawing needs no names at all.
+	enum class Uniform
+	{
+		PositionScale,
+		PositionOffset,
+		OctahedralNormals,
+		TextureLayer,
+		MaterialSpecular,
+		MaterialShininess,
+		Count
+	};
+
 	class Shader
 	{
 	public:
 		GLuint ID;
-		Shader() : ID{ 1000 } {}
+		Shader();
 		Shader(const GLchar* vertexPath, const GLchar* fragmentPath);
 		void use();
+
+		// Location of an active uniform, -1 when the program has none by that
+		// name. Reads the table built at link time, so it makes no GL calls,
+		// but hashes the name, so look locations up once and keep them.
+		GLint location(const std::string& name) const;
+		GLint location(Uniform uniform) const { return known[(int)uniform]; }
+
+		// Set a uniform of the program in use, skipped when the location is -1
+		void set(GLint location, GLint value);
+		void set(GLint location, GLfloat value);
+		void set(GLint location, const glm::vec3& value);
+		void set(GLint location, const glm::vec4& value);
+		void set(GLint location, const glm::mat4& value);
+		template <class T>
+		void set(Uniform uniform, const T& value) { set(location(uniform), value); }
+
+	private:
+		std::unordered_map<std::string, GLint> uniforms; // active uniform name to location
+		GLint known[(int)Uniform::Count];
+
+		void reflect();
 	};
 }
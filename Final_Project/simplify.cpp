@@ -0,0 +1,363 @@
+/*
+* simplify.cpp
+* This file contains implementations for mesh simplification and LOD generation
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+* Error metric from Garland and Heckbert,
+* "Surface Simplification Using Quadric Error Metrics", 1997.
+*/
+
+#include "simplify.h"
+#include "meshopt.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <glm/glm.hpp>
+
+namespace simplify
+{
+	// Helper functions
+
+	// Sum of squared distances to a set of planes, weighted by triangle area
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2, weight;
+		Quadric() : a2{ 0 }, ab{ 0 }, ac{ 0 }, ad{ 0 }, b2{ 0 }, bc{ 0 }, bd{ 0 }, c2{ 0 }, cd{ 0 }, d2{ 0 }, weight{ 0 } {}
+
+		void addPlane(const glm::dvec3& normal, double distance, double planeWeight)
+		{
+			a2 += normal.x * normal.x * planeWeight;
+			ab += normal.x * normal.y * planeWeight;
+			ac += normal.x * normal.z * planeWeight;
+			ad += normal.x * distance * planeWeight;
+			b2 += normal.y * normal.y * planeWeight;
+			bc += normal.y * normal.z * planeWeight;
+			bd += normal.y * distance * planeWeight;
+			c2 += normal.z * normal.z * planeWeight;
+			cd += normal.z * distance * planeWeight;
+			d2 += distance * distance * planeWeight;
+			weight += planeWeight;
+		}
+
+		void add(const Quadric& other)
+		{
+			a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+			b2 += other.b2; bc += other.bc; bd += other.bd;
+			c2 += other.c2; cd += other.cd; d2 += other.d2;
+			weight += other.weight;
+		}
+
+		// Area weighted mean squared distance of a point to the planes
+		double error(const glm::dvec3& p) const
+		{
+			double sum = a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z
+				+ 2.0 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z)
+				+ 2.0 * (ad * p.x + bd * p.y + cd * p.z) + d2;
+			return weight > 0.0 ? std::fabs(sum) / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		GLuint from, to;
+		double cost;
+		bool operator<(const Collapse& other) const { return cost < other.cost; }
+	};
+
+	glm::dvec3 position(const float* positions, size_t stride, GLuint vertex)
+	{
+		const float* p = (const float*)((const char*)positions + vertex * stride);
+		return glm::dvec3(p[0], p[1], p[2]);
+	}
+
+	// Vertices that must keep their position: on open borders, on seams
+	// and on edges shared by more than two triangles
+	std::vector<bool> findLocked(const std::vector<GLuint>& indices, const float* positions, size_t stride,
+		size_t vertexCount)
+	{
+		// Vertices with the same position share one id
+		std::map<std::vector<float>, GLuint> ids;
+		std::vector<GLuint> positionId(vertexCount);
+		std::vector<GLuint> copies;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			const float* p = (const float*)((const char*)positions + v * stride);
+			std::vector<float> key(p, p + 3);
+			std::map<std::vector<float>, GLuint>::iterator found = ids.find(key);
+			if (found == ids.end())
+			{
+				found = ids.insert(std::make_pair(key, (GLuint)copies.size())).first;
+				copies.push_back(0);
+			}
+			positionId[v] = found->second;
+		}
+
+		// Only vertices the triangles use count as copies
+		std::vector<bool> used(vertexCount, false);
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			used[indices[i]] = true;
+		}
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			if (used[v])
+			{
+				copies[positionId[v]]++;
+			}
+		}
+
+		// Undirected edge uses, by position
+		std::map<std::pair<GLuint, GLuint>, int> edges;
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			for (size_t e = 0; e < 3; e++)
+			{
+				GLuint a = positionId[indices[t + e]];
+				GLuint b = positionId[indices[t + (e + 1) % 3]];
+				edges[std::make_pair(std::min(a, b), std::max(a, b))]++;
+			}
+		}
+
+		std::vector<bool> lockedPositions(copies.size(), false);
+		for (size_t p = 0; p < copies.size(); p++)
+		{
+			lockedPositions[p] = copies[p] > 1;
+		}
+		std::map<std::pair<GLuint, GLuint>, int>::iterator it;
+		for (it = edges.begin(); it != edges.end(); it++)
+		{
+			if (it->second != 2)
+			{
+				lockedPositions[it->first.first] = true;
+				lockedPositions[it->first.second] = true;
+			}
+		}
+
+		std::vector<bool> locked(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			locked[v] = lockedPositions[positionId[v]];
+		}
+		return locked;
+	}
+
+	// True if moving a vertex flips or collapses any triangle it keeps
+	bool flips(const std::vector<GLuint>& indices, const std::vector<GLuint>& triangles,
+		const float* positions, size_t stride, GLuint from, GLuint to)
+	{
+		glm::dvec3 target = position(positions, stride, to);
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			const GLuint* triangle = &indices[triangles[i] * 3];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			{
+				continue; // removed by the collapse
+			}
+
+			glm::dvec3 before[3], after[3];
+			for (size_t c = 0; c < 3; c++)
+			{
+				before[c] = position(positions, stride, triangle[c]);
+				after[c] = (triangle[c] == from) ? target : before[c];
+			}
+			glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			if (glm::dot(normalBefore, normalAfter) <= 0.0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	float simplify(std::vector<GLuint>& destination, const std::vector<GLuint>& indices,
+		const float* positions, size_t stride, size_t vertexCount,
+		size_t targetIndexCount, float maxError)
+	{
+		destination = indices;
+		std::vector<bool> locked = findLocked(indices, positions, stride, vertexCount);
+
+		// Plane quadrics of the triangles around each vertex
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			glm::dvec3 p0 = position(positions, stride, indices[t]);
+			glm::dvec3 p1 = position(positions, stride, indices[t + 1]);
+			glm::dvec3 p2 = position(positions, stride, indices[t + 2]);
+			glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+			double area = glm::length(normal);
+			if (area <= 0.0)
+			{
+				continue;
+			}
+			normal /= area;
+			Quadric plane;
+			plane.addPlane(normal, -glm::dot(normal, p0), area);
+			for (size_t c = 0; c < 3; c++)
+			{
+				quadrics[indices[t + c]].add(plane);
+			}
+		}
+
+		double maxCost = (double)maxError * maxError;
+		double worstCost = 0.0;
+		std::vector<std::vector<GLuint>> vertexTriangles(vertexCount);
+		std::vector<GLuint> remap(vertexCount);
+		std::vector<bool> touched(vertexCount);
+		std::vector<Collapse> collapses;
+
+		// Each pass collapses a batch of non-overlapping edges, cheapest first
+		while (destination.size() > targetIndexCount)
+		{
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				vertexTriangles[v].clear();
+				remap[v] = (GLuint)v;
+				touched[v] = false;
+			}
+			collapses.clear();
+			for (size_t t = 0; t < destination.size(); t += 3)
+			{
+				for (size_t e = 0; e < 3; e++)
+				{
+					GLuint a = destination[t + e];
+					GLuint b = destination[t + (e + 1) % 3];
+					vertexTriangles[a].push_back((GLuint)(t / 3));
+
+					Collapse collapse;
+					if (!locked[a])
+					{
+						collapse.from = a;
+						collapse.to = b;
+						Quadric merged = quadrics[a];
+						merged.add(quadrics[b]);
+						collapse.cost = merged.error(position(positions, stride, b));
+						collapses.push_back(collapse);
+					}
+					if (!locked[b])
+					{
+						collapse.from = b;
+						collapse.to = a;
+						Quadric merged = quadrics[b];
+						merged.add(quadrics[a]);
+						collapse.cost = merged.error(position(positions, stride, a));
+						collapses.push_back(collapse);
+					}
+				}
+			}
+			std::sort(collapses.begin(), collapses.end());
+
+			// An interior collapse removes about two triangles
+			size_t wanted = (destination.size() - targetIndexCount) / 6 + 1;
+			size_t done = 0;
+			for (size_t i = 0; i < collapses.size() && done < wanted; i++)
+			{
+				const Collapse& collapse = collapses[i];
+				if (collapse.cost > maxCost)
+				{
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to]
+					|| flips(destination, vertexTriangles[collapse.from], positions, stride, collapse.from, collapse.to))
+				{
+					continue;
+				}
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+				worstCost = std::max(worstCost, collapse.cost);
+				done++;
+
+				// Later collapses this pass must not see the triangles around it
+				const std::vector<GLuint>& around = vertexTriangles[collapse.from];
+				for (size_t t = 0; t < around.size(); t++)
+				{
+					for (size_t c = 0; c < 3; c++)
+					{
+						touched[destination[around[t] * 3 + c]] = true;
+					}
+				}
+			}
+			if (done == 0)
+			{
+				break;
+			}
+
+			// Applies the pass and drops triangles that lost an edge
+			size_t written = 0;
+			for (size_t t = 0; t < destination.size(); t += 3)
+			{
+				GLuint a = remap[destination[t]];
+				GLuint b = remap[destination[t + 1]];
+				GLuint c = remap[destination[t + 2]];
+				if (a != b && b != c && a != c)
+				{
+					destination[written++] = a;
+					destination[written++] = b;
+					destination[written++] = c;
+				}
+			}
+			destination.resize(written);
+		}
+		return (float)std::sqrt(worstCost);
+	}
+
+	std::vector<mesh::Lod> buildLods(std::vector<GLuint>& indices,
+		const float* positions, size_t stride, size_t vertexCount)
+	{
+		std::vector<mesh::Lod> lods;
+		mesh::Lod full;
+		full.firstIndex = 0;
+		full.indexCount = (GLsizei)indices.size();
+		full.error = 0.0f;
+		lods.push_back(full);
+		if (indices.size() < 3 || indices.size() % 3 != 0)
+		{
+			return lods;
+		}
+
+		// Errors are capped relative to the size of the mesh
+		glm::dvec3 boundsMin = position(positions, stride, indices[0]);
+		glm::dvec3 boundsMax = boundsMin;
+		for (size_t i = 1; i < indices.size(); i++)
+		{
+			boundsMin = glm::min(boundsMin, position(positions, stride, indices[i]));
+			boundsMax = glm::max(boundsMax, position(positions, stride, indices[i]));
+		}
+		float maxError = (float)glm::length(boundsMax - boundsMin) * MAX_RELATIVE_ERROR;
+
+		std::vector<GLuint> previous(indices.begin(), indices.end());
+		float error = 0.0f;
+		for (size_t level = 1; level < MAX_LODS && error < maxError; level++)
+		{
+			size_t target = (size_t)(previous.size() / 3 * LOD_REDUCTION) * 3;
+			std::vector<GLuint> simplified;
+			// Each level starts from the previous one, so errors add up
+			float levelError = simplify(simplified, previous, positions, stride, vertexCount, target, maxError - error);
+			if (simplified.size() < 3 || simplified.size() > previous.size() * (1.0f - MIN_REDUCTION))
+			{
+				break;
+			}
+			error += levelError;
+
+			std::vector<GLuint> ordered(simplified.size());
+			meshopt::optimizeVertexCache(ordered.data(), simplified.data(), simplified.size(), vertexCount);
+
+			mesh::Lod lod;
+			lod.firstIndex = (GLuint)indices.size();
+			lod.indexCount = (GLsizei)ordered.size();
+			lod.error = error;
+			lods.push_back(lod);
+			indices.insert(indices.end(), ordered.begin(), ordered.end());
+			previous.swap(ordered);
+		}
+		return lods;
+	}
+}
@@ -0,0 +1,54 @@
+/*
+* simplify.h
+* This file contains declarations for mesh simplification and LOD generation
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+* Error metric from Garland and Heckbert,
+* "Surface Simplification Using Quadric Error Metrics", 1997.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include "mesh.h"
+
+// Levels of detail are made by collapsing edges onto one of their two
+// vertices, so every level indexes the same vertex buffer and only needs
+// its own index range. Vertices on open borders and on seams (several
+// vertices sharing a position, e.g. where UVs are split) never move, which
+// keeps texture seams and holes intact at the cost of some reduction.
+
+namespace simplify
+{
+	// Part of the mesh cache key, changing the levels this builds must change it
+	const std::string VERSION = "quadric collapse 1";
+	// Levels per mesh including the full detail one
+	const size_t MAX_LODS = 4;
+	// Each level aims for this fraction of the previous level's triangles
+	const float LOD_REDUCTION = 0.5f;
+	// A level is dropped unless it removes at least this fraction of triangles
+	const float MIN_REDUCTION = 0.15f;
+	// Largest error any level may have, as a fraction of the mesh's bounding box diagonal
+	const float MAX_RELATIVE_ERROR = 0.05f;
+
+	// Collapses edges until the triangle list has at most targetIndexCount
+	// indices or no collapse stays under maxError. positions points at the
+	// first vertex position, stride is in bytes. Returns the largest error
+	// of any collapse, as a distance in model units.
+	float simplify(std::vector<GLuint>& destination, const std::vector<GLuint>& indices,
+		const float* positions, size_t stride, size_t vertexCount,
+		size_t targetIndexCount, float maxError);
+
+	// Appends simplified levels to indices and returns every level as an
+	// index range, starting with the full detail one
+	std::vector<mesh::Lod> buildLods(std::vector<GLuint>& indices,
+		const float* positions, size_t stride, size_t vertexCount);
+}
@@ -0,0 +1,249 @@
+/*
+* texturearrays.cpp
+* This file contains implementations for sharing 2D array textures between images
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "texturearrays.h"
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <tuple>
+#include "glstate.h"
+#include "gpumem.h"
+#include "mipmaps.h"
+
+namespace texturearrays
+{
+	// Internal format, width, height and levels shared by the layers of an array
+	typedef std::tuple<GLenum, GLsizei, GLsizei, GLsizei> Key;
+
+	std::list<Array> arrays;
+	// Images expected but not yet added, by key
+	std::map<Key, GLsizei> expected;
+
+	// Helper functions
+	GLsizei chainLength(GLsizei width, GLsizei height)
+	{
+		// Same chain as mipmaps::generate, halving down to 1x1
+		GLsizei levels = 1;
+		while (width > 1 || height > 1)
+		{
+			width = (width > 1) ? width / 2 : 1;
+			height = (height > 1) ? height / 2 : 1;
+			levels++;
+		}
+		return levels;
+	}
+
+	Array& createArray(GLenum internalFormat, const std::vector<ktx::Level>& levels, size_t layerBytes)
+	{
+		// The first array takes every expected image, later ones double the
+		// largest array of this size and format, which is already full
+		Key key{ internalFormat, levels.at(0).width, levels.at(0).height, (GLsizei)levels.size() };
+		GLsizei layers = 1;
+		std::map<Key, GLsizei>::iterator pending = expected.find(key);
+		if (pending != expected.end())
+		{
+			layers = std::max(layers, pending->second);
+		}
+		std::list<Array>::iterator it;
+		for (it = arrays.begin(); it != arrays.end(); it++)
+		{
+			if (it->internalFormat == internalFormat && it->width == levels.at(0).width
+				&& it->height == levels.at(0).height && it->levels == (GLsizei)levels.size())
+			{
+				layers = std::max(layers, (GLsizei)it->used.size() * 2);
+			}
+		}
+		GLint maxLayers = 0;
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+		layers = std::min(layers, (GLsizei)std::max(ARRAY_BYTES / layerBytes, (size_t)1));
+		layers = std::min(layers, (GLsizei)maxLayers);
+
+		arrays.push_back(Array());
+		Array& array = arrays.back();
+		array.internalFormat = internalFormat;
+		array.width = levels.at(0).width;
+		array.height = levels.at(0).height;
+		array.levels = (GLsizei)levels.size();
+		array.layerBytes = layerBytes;
+		array.used.assign(layers, false);
+
+		glGenTextures(1, &array.id);
+		bind(array.id);
+		// Storage only, the format and type describe data that isn't passed
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, internalFormat, levels.at(i).width, levels.at(i).height, layers,
+				0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, array.levels - 1);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		gpumem::trackPool(array.id, gpumem::Kind::Texture, layerBytes * layers, "texturearrays");
+		return array;
+	}
+
+	void expect(const textures::Image& image)
+	{
+		if (image.levels.empty() && image.data == NULL)
+		{
+			return;
+		}
+		GLenum internalFormat = image.compressedFormat != 0 ? image.compressedFormat : textures::format(image.components);
+		if (image.levels.empty())
+		{
+			expected[Key(internalFormat, image.width, image.height, chainLength(image.width, image.height))]++;
+		}
+		else
+		{
+			expected[Key(internalFormat, image.levels.at(0).width, image.levels.at(0).height,
+				(GLsizei)image.levels.size())]++;
+		}
+	}
+
+	textures::Layer add(const textures::Image& image)
+	{
+		textures::Layer layer;
+		std::vector<ktx::Level> generated;
+		const std::vector<ktx::Level>* levels = &image.levels;
+		if (levels->empty())
+		{
+			if (image.data == NULL)
+			{
+				std::cout << "Texture failed to load at path: " << image.path << std::endl;
+				return layer;
+			}
+			mipmaps::generate(image.data, image.width, image.height, image.components, generated, false);
+			levels = &generated;
+		}
+
+		bool compressed = image.compressedFormat != 0;
+		GLenum pixelFormat = textures::format(image.components);
+		GLenum internalFormat = compressed ? image.compressedFormat : pixelFormat;
+		size_t layerBytes = 0;
+		for (size_t i = 0; i < levels->size(); i++)
+		{
+			layerBytes += levels->at(i).data.size();
+		}
+
+		// First free layer of an array with this size and format
+		Array* array = NULL;
+		std::list<Array>::iterator it;
+		for (it = arrays.begin(); it != arrays.end() && array == NULL; it++)
+		{
+			if (it->internalFormat != internalFormat || it->width != levels->at(0).width
+				|| it->height != levels->at(0).height || it->levels != (GLsizei)levels->size())
+			{
+				continue;
+			}
+			std::vector<bool>::iterator open = std::find(it->used.begin(), it->used.end(), false);
+			if (open != it->used.end())
+			{
+				array = &*it;
+				layer.layer = (GLint)(open - it->used.begin());
+			}
+		}
+		if (array == NULL)
+		{
+			array = &createArray(internalFormat, *levels, layerBytes);
+			layer.layer = 0;
+		}
+		array->used.at(layer.layer) = true;
+		layer.array = array->id;
+		std::map<Key, GLsizei>::iterator pending =
+			expected.find(Key(internalFormat, array->width, array->height, array->levels));
+		if (pending != expected.end() && --pending->second <= 0)
+		{
+			expected.erase(pending);
+		}
+		// Charged to whoever loads the image first, later users share it through the cache
+		gpumem::trackRange(array->id, gpumem::Kind::Texture, (size_t)layer.layer, layerBytes, image.path);
+
+		bind(array->id);
+		// Rows of odd-width RGB and single channel images are not 4 byte aligned
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (size_t i = 0; i < levels->size(); i++)
+		{
+			const ktx::Level& level = levels->at(i);
+			if (compressed)
+			{
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, layer.layer, level.width, level.height, 1,
+					internalFormat, (GLsizei)level.data.size(), level.data.data());
+			}
+			else
+			{
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, layer.layer, level.width, level.height, 1,
+					pixelFormat, GL_UNSIGNED_BYTE, level.data.data());
+			}
+		}
+		return layer;
+	}
+
+	void free(const textures::Layer& layer)
+	{
+		std::list<Array>::iterator it;
+		for (it = arrays.begin(); it != arrays.end(); it++)
+		{
+			if (it->id != layer.array)
+			{
+				continue;
+			}
+			it->used.at(layer.layer) = false;
+			gpumem::releaseRange(it->id, gpumem::Kind::Texture, (size_t)layer.layer);
+			if (std::find(it->used.begin(), it->used.end(), true) == it->used.end())
+			{
+				glDeleteTextures(1, &it->id);
+				gpumem::release(it->id, gpumem::Kind::Texture);
+				glstate::deletedTexture(it->id);
+				arrays.erase(it);
+			}
+			return;
+		}
+	}
+
+	void bind(GLuint array)
+	{
+		glstate::bindTexture(0, GL_TEXTURE_2D_ARRAY, array);
+	}
+
+	void clear()
+	{
+		std::list<Array>::iterator it;
+		for (it = arrays.begin(); it != arrays.end(); it++)
+		{
+			glDeleteTextures(1, &it->id);
+			glstate::deletedTexture(it->id);
+			gpumem::release(it->id, gpumem::Kind::Texture);
+		}
+		arrays.clear();
+		expected.clear();
+	}
+
+	void report(std::ostream& out)
+	{
+		out << "---- Texture arrays: " << arrays.size() << " arrays ----" << std::endl;
+		std::list<Array>::iterator it;
+		for (it = arrays.begin(); it != arrays.end(); it++)
+		{
+			const Array& array = *it;
+			size_t used = std::count(array.used.begin(), array.used.end(), true);
+			out << "  format " << array.internalFormat
+				<< "  " << array.width << "x" << array.height << "x" << array.levels
+				<< "  layers " << std::setw(4) << used << " / " << std::setw(4) << array.used.size()
+				<< std::fixed << std::setprecision(1)
+				<< "  " << std::setw(8) << array.layerBytes * array.used.size() / 1024.0 << " KiB" << std::endl;
+		}
+	}
+}
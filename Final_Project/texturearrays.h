@@ -0,0 +1,58 @@
+/*
+* texturearrays.h
+* This file contains declarations for sharing 2D array textures between images
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <iostream>
+#include <list>
+#include <vector>
+#include "textures.h"
+
+// Images don't get a texture of their own. Images of the same size,
+// format and mip count are layers of one GL_TEXTURE_2D_ARRAY, and the
+// shaders pick the layer with the textureLayer uniform, so meshes using
+// any of them draw without binding another texture. Arrays can't grow in
+// GL 3.3 without copying every layer, so the first array of a size and
+// format holds every image a loader said to expect, and a full array gets
+// a new one twice its size next to it.
+
+namespace texturearrays
+{
+	// Arrays stop doubling at this size, larger images get one layer each
+	const size_t ARRAY_BYTES = 32 * 1024 * 1024;
+
+	struct Array
+	{
+		GLuint id;
+		GLenum internalFormat;
+		GLsizei width, height, levels;
+		size_t layerBytes;      // every level of one layer
+		std::vector<bool> used; // one per layer
+	};
+
+	// Counts an image that is about to be added, so a new array of its size
+	// and format is made with a layer for it. add uncounts it again.
+	void expect(const textures::Image& image);
+	// Uploads every mip level of the image into a free layer, creating an
+	// array when none of its size and format has room. Must run on the
+	// render thread. Images without levels are mipmapped first.
+	textures::Layer add(const textures::Image& image);
+	// Frees the layer, the array is deleted with its last layer
+	void free(const textures::Layer& layer);
+	// Binds an array to texture unit 0, unless it's already bound there
+	void bind(GLuint array);
+	// Deletes every array, all layers are invalid afterwards
+	void clear();
+	void report(std::ostream& out);
+}
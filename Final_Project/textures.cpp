@@ -0,0 +1,266 @@
+/*
+* textures.cpp
+* This file contains implementations for decoding and uploading textures
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "textures.h"
+#include "bcn.h"
+#include "mipmaps.h"
+#include "profiler.h"
+#include "texturearrays.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+namespace textures
+{
+	// Helper functions
+
+	// Compressed and uncompressed chains are kept apart so switching doesn't rebuild them
+	std::string cachePath(const std::string& path, bool compressed)
+	{
+		return path + (compressed ? ".ktx" : ".mips.ktx");
+	}
+
+	std::string writerName(bool compressed)
+	{
+		return compressed ? bcn::ENCODER + ", " + mipmaps::FILTER : mipmaps::FILTER;
+	}
+
+	// Whether the cached copy exists and is at least as new as the image
+	bool isFresh(const std::string& path, const std::string& cachePath)
+	{
+		std::error_code error;
+		std::filesystem::file_time_type source = std::filesystem::last_write_time(path, error);
+		if (error)
+		{
+			return false;
+		}
+		std::filesystem::file_time_type cached = std::filesystem::last_write_time(cachePath, error);
+		return !error && cached >= source;
+	}
+
+	int components(GLenum pixelFormat)
+	{
+		switch (pixelFormat)
+		{
+		case GL_RED: return 1;
+		case GL_RG: return 2;
+		case GL_RGB: return 3;
+		default: return 4;
+		}
+	}
+
+	// Replaces every level's pixels with their compressed blocks
+	void compressLevels(Image& image, bool parallel)
+	{
+		bcn::Format format = bcn::formatFor(image.components);
+		for (size_t i = 0; i < image.levels.size(); i++)
+		{
+			ktx::Level& level = image.levels.at(i);
+			std::vector<unsigned char> blocks(bcn::compressedSize(format, level.width, level.height));
+			bcn::compress(level.data.data(), level.width, level.height, image.components, format, blocks.data(), parallel);
+			level.data.swap(blocks);
+		}
+		image.compressedFormat = bcn::internalFormat(format);
+	}
+
+	Image decode(const std::string& path, bool compress, bool parallel)
+	{
+		Image image;
+		image.path = path;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::string cached = cachePath(path, compress);
+		ktx::PixelFormat pixelFormat;
+		if (isFresh(path, cached) && ktx::read(cached, writerName(compress), pixelFormat, image.levels))
+		{
+			image.width = image.levels.at(0).width;
+			image.height = image.levels.at(0).height;
+			if (compress)
+			{
+				image.compressedFormat = pixelFormat.internalFormat;
+			}
+			else
+			{
+				image.components = components(pixelFormat.format);
+			}
+			image.decodeMs = profiler::elapsedMs(start);
+			return image;
+		}
+
+		unsigned char* pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+		if (pixels)
+		{
+			mipmaps::generate(pixels, image.width, image.height, image.components, image.levels, parallel);
+			stbi_image_free(pixels);
+
+			if (compress)
+			{
+				compressLevels(image, parallel);
+				bcn::Format format = bcn::formatFor(image.components);
+				pixelFormat = ktx::PixelFormat{ 0, 0, bcn::internalFormat(format), bcn::baseFormat(format) };
+			}
+			else
+			{
+				GLenum imageFormat = format(image.components);
+				pixelFormat = ktx::PixelFormat{ GL_UNSIGNED_BYTE, imageFormat, imageFormat, imageFormat };
+			}
+			ktx::write(cached, pixelFormat, image.levels, writerName(compress));
+		}
+		image.decodeMs = profiler::elapsedMs(start);
+
+		return image;
+	}
+
+	bool supportsCompression()
+	{
+		// RGTC is core since 3.0, S3TC is still an extension
+		static int supported = -1;
+		if (supported < 0)
+		{
+			supported = 0;
+			GLint count = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+			for (GLint i = 0; i < count; i++)
+			{
+				const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+				if (name && std::string(name) == "GL_EXT_texture_compression_s3tc")
+				{
+					supported = 1;
+					break;
+				}
+			}
+		}
+		return supported == 1;
+	}
+
+	void release(const Image& image)
+	{
+		stbi_image_free(image.data);
+	}
+
+	GLenum format(int components)
+	{
+		GLenum format{};
+		if (components == 1)
+		{
+			format = GL_RED;
+		}
+		else if (components == 2)
+		{
+			format = GL_RG;
+		}
+		else if (components == 3)
+		{
+			format = GL_RGB;
+		}
+		else if (components == 4)
+		{
+			format = GL_RGBA;
+		}
+		return format;
+	}
+
+	// TextureCache class
+	std::string TextureCache::key(const std::string& path)
+	{
+		std::error_code error;
+		std::filesystem::path absolute = std::filesystem::absolute(path, error);
+		std::string normalized = std::filesystem::weakly_canonical(absolute, error).generic_string();
+		if (error)
+		{
+			normalized = absolute.lexically_normal().generic_string();
+		}
+#ifdef _WIN32
+		// Windows paths are case insensitive
+		std::transform(normalized.begin(), normalized.end(), normalized.begin(), ::tolower);
+#endif
+		return normalized;
+	}
+
+	bool TextureCache::contains(const std::string& cacheKey)
+	{
+		return entries.find(cacheKey) != entries.end();
+	}
+
+	Layer TextureCache::add(const std::string& cacheKey, const Image& image)
+	{
+		Entry entry;
+		entry.layer = texturearrays::add(image);
+		entry.references = 1;
+		entries[cacheKey] = entry;
+		keys[std::make_pair(entry.layer.array, entry.layer.layer)] = cacheKey;
+		return entry.layer;
+	}
+
+	Layer TextureCache::acquire(const std::string& path)
+	{
+		std::string cacheKey = key(path);
+		std::unordered_map<std::string, Entry>::iterator found = entries.find(cacheKey);
+		if (found != entries.end())
+		{
+			found->second.references++;
+			return found->second.layer;
+		}
+
+		// Runs on the render thread, so mipmapping and compression can use the whole pool
+		Image image = decode(path, compress && supportsCompression(), true);
+		Layer layer = add(cacheKey, image);
+		textures::release(image);
+		return layer;
+	}
+
+	Layer TextureCache::acquire(const Image& image)
+	{
+		std::string cacheKey = key(image.path);
+		std::unordered_map<std::string, Entry>::iterator found = entries.find(cacheKey);
+		if (found != entries.end())
+		{
+			found->second.references++;
+			return found->second.layer;
+		}
+		return add(cacheKey, image);
+	}
+
+	void TextureCache::release(const Layer& layer)
+	{
+		std::map<std::pair<GLuint, GLint>, std::string>::iterator found =
+			keys.find(std::make_pair(layer.array, layer.layer));
+		if (found == keys.end())
+		{
+			return;
+		}
+
+		Entry& entry = entries[found->second];
+		entry.references--;
+		if (entry.references <= 0)
+		{
+			texturearrays::free(layer);
+			entries.erase(found->second);
+			keys.erase(found);
+		}
+	}
+
+	void TextureCache::clear()
+	{
+		texturearrays::clear();
+		entries.clear();
+		keys.clear();
+	}
+
+	TextureCache& cache()
+	{
+		static TextureCache shared;
+		return shared;
+	}
+}
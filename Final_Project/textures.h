@@ -0,0 +1,99 @@
+/*
+* textures.h
+* This file contains declarations for decoding and uploading textures
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <glad/glad.h>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ktx.h"
+#include "stb_image.h"
+
+namespace textures
+{
+	// Decoded pixels of an image file. Images from decode have no pixels,
+	// just every mip level, compressed when compressedFormat is set.
+	// data is for callers that decode themselves.
+	struct Image
+	{
+		unsigned char* data;
+		int width, height, components;
+		std::string path;
+		double decodeMs; // includes mipmapping and compressing, or reading the cached copy
+		GLenum compressedFormat;
+		std::vector<ktx::Level> levels;
+		Image() : data{ NULL }, width{ 0 }, height{ 0 }, components{ 0 }, decodeMs{ 0.0 }, compressedFormat{ 0 } {}
+	};
+
+	// Reads and decodes an image and builds its mip chain, makes no GL calls so
+	// it can run on a worker thread. With compress every level is block
+	// compressed. The chain is read from a .ktx file next to the image when
+	// that is newer than the image, and written there when it isn't.
+	// parallel spreads the work over the worker pool, so only pass it from
+	// outside the pool.
+	Image decode(const std::string& path, bool compress = false, bool parallel = false);
+	// Whether the driver takes BC1 and BC3 textures, must run on the render thread
+	bool supportsCompression();
+	// Frees the decoded pixels
+	void release(const Image& image);
+	// GL pixel format matching the number of channels
+	GLenum format(int components);
+
+	// Where an uploaded image lives, see texturearrays
+	struct Layer
+	{
+		GLuint array;
+		GLint layer;
+		Layer() : array{ 0 }, layer{ 0 } {}
+	};
+
+	// Textures shared by every loader in the process, so each image is
+	// decoded and uploaded once, into a layer of a texture array. Keys are
+	// normalized absolute paths.
+	class TextureCache
+	{
+	public:
+		// Upload compressed textures when the driver supports them
+		bool compress;
+		TextureCache() : compress{ true } {}
+		// Normalizes a path so different spellings of one file share a key
+		static std::string key(const std::string& path);
+		bool contains(const std::string& key);
+		// Returns the layer for a file and adds a reference,
+		// decodes and uploads it on the first request
+		Layer acquire(const std::string& path);
+		// Same as acquire, but uploads an image that was already decoded
+		Layer acquire(const Image& image);
+		// Drops a reference, the layer is freed when none are left
+		void release(const Layer& layer);
+		// Deletes every texture regardless of references
+		void clear();
+		size_t size() { return entries.size(); }
+
+	private:
+		struct Entry
+		{
+			Layer layer;
+			int references;
+		};
+		std::unordered_map<std::string, Entry> entries;
+		std::map<std::pair<GLuint, GLint>, std::string> keys; // array and layer to key
+
+		Layer add(const std::string& cacheKey, const Image& image);
+	};
+
+	// Cache used by mesh::TriangleMesh and model::Model
+	TextureCache& cache();
+}
@@ -0,0 +1,92 @@
+/*
+* workers.cpp
+* This file contains implementations for the worker thread pool
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#include "workers.h"
+#include <algorithm>
+
+namespace workers
+{
+	ThreadPool::ThreadPool(size_t threadCount)
+	{
+		stopping = false;
+		for (size_t i = 0; i < threadCount; i++)
+		{
+			threads.push_back(std::thread(&ThreadPool::work, this));
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ queueMutex };
+			stopping = true;
+		}
+		wake.notify_all();
+		for (size_t i = 0; i < threads.size(); i++)
+		{
+			threads.at(i).join();
+		}
+	}
+
+	void ThreadPool::work()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock{ queueMutex };
+				wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				// Finishes queued jobs before stopping
+				if (jobs.empty())
+				{
+					return;
+				}
+				job = jobs.front();
+				jobs.pop();
+			}
+			job();
+		}
+	}
+
+	ThreadPool& pool()
+	{
+		size_t cores = std::thread::hardware_concurrency();
+		static ThreadPool shared{ (cores > 1) ? cores - 1 : 1 };
+		return shared;
+	}
+
+	void parallelFor(size_t count, const std::function<void(size_t, size_t)>& job)
+	{
+		ThreadPool& shared = pool();
+		if (count < 2 || shared.size() == 0)
+		{
+			job(0, count);
+			return;
+		}
+
+		// A few ranges per thread keeps the threads busy when ranges differ in cost
+		size_t rangeCount = std::min(count, shared.size() * 4);
+		std::vector<std::future<void>> ranges;
+		for (size_t r = 0; r < rangeCount; r++)
+		{
+			size_t first = count * r / rangeCount;
+			size_t end = count * (r + 1) / rangeCount;
+			ranges.push_back(shared.submit([&job, first, end]() { job(first, end); }));
+		}
+		for (size_t r = 0; r < ranges.size(); r++)
+		{
+			ranges.at(r).get();
+		}
+	}
+}
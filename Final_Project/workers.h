@@ -0,0 +1,69 @@
+/*
+* workers.h
+* This file contains declarations for the worker thread pool
+* author      :  Jake Sheehan
+* institution :  Southern New Hampshire University
+* professor   :  Kurt Diesch
+* date        :  October 24, 2021
+*
+* References  :
+* This code is largely the result of following along
+* with the reading at learnopengl.com, which is licensed
+* under the terms of Creative Commons CC BY-NC 4.0.
+*/
+
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace workers
+{
+	// Fixed set of threads that run queued jobs. Jobs must not make
+	// OpenGL calls, the context only belongs to the render thread.
+	class ThreadPool
+	{
+	public:
+		ThreadPool(size_t threadCount);
+		~ThreadPool();
+		size_t size() { return threads.size(); }
+
+		// Queues a job and returns a future for its result
+		template <class F>
+		std::future<typename std::invoke_result<F>::type> submit(F job)
+		{
+			typedef typename std::invoke_result<F>::type Result;
+			std::shared_ptr<std::packaged_task<Result()>> task =
+				std::make_shared<std::packaged_task<Result()>>(job);
+			std::future<Result> result = task->get_future();
+			{
+				std::lock_guard<std::mutex> lock{ queueMutex };
+				jobs.push([task]() { (*task)(); });
+			}
+			wake.notify_one();
+			return result;
+		}
+
+	private:
+		std::vector<std::thread> threads;
+		std::queue<std::function<void()>> jobs;
+		std::mutex queueMutex;
+		std::condition_variable wake;
+		bool stopping;
+
+		void work();
+	};
+
+	// Pool shared by the loaders, one thread per core minus the render thread
+	ThreadPool& pool();
+
+	// Splits [0, count) into ranges, runs job(first, end) for each on the
+	// shared pool and waits for all of them. Jobs waiting on jobs can
+	// deadlock the pool, so only call this from outside it.
+	void parallelFor(size_t count, const std::function<void(size_t, size_t)>& job);
+}